@@ -0,0 +1,898 @@
+/*
+ * \file FoolsEffects.c
+ *
+ * \brief The lantern animations and the table that dispatches to them
+ *
+ *	effectTable[] has one entry per subMode, in FoolsModes.h order, and lives in flash.  The
+ *	dispatcher reads the function pointers out of it, so adding an effect does not touch
+ *	effectSelect(), effectParam() or effectStep().  The state of the running effect is in
+ *	effectState, which is only as big as the largest effect needs.
+ *
+ *	The loops over the LED array count with ledindex_t and walk local copies of LEDarray and
+ *	LEDpattern.  Without LED_DITHER an ledval_t is a char type, which may alias anything, so
+ *	indexing the globals has the compiler load them again after every store.
+ */
+
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "config.h"
+#include "FoolsModes.h"
+#include "FoolsEffects.h"
+#include "FoolsEnvelopes.h"
+#include "FoolsColor.h"
+#include "FoolsNoise.h"
+#include "FoolsLayers.h"
+#include "LEDBench.h"
+
+/*****************************************************************************
+ Preprocessor definitions
+*****************************************************************************/
+
+#define THROB_PERIOD				8000		// mS for one throb, unless modeParam sets it
+#define BREATHE_PERIOD				5000		// mS for one breath, unless modeParam sets it
+#define ENVELOPE_LEGACY_DELTA		256			// modeParam below this is the old THROB change per step
+
+#define RAINBOW_SPEED				2			// Hue change each step, unless modeParam sets it
+#define RAINBOW_SPREAD				((NUM_LEDS < 256) ? 256 / NUM_LEDS : 1)	// One turn of the wheel along the strip
+
+// Noise effects: 256ths of a noise cell from one LED to the next, and that the noise moves on
+// each step, unless modeParam sets them
+#define FIRE_SCALE					48
+#define FIRE_SPEED					40
+#define FIRE_FLOOR					64			// Noise below this is dark between the flames
+#define PLASMA_SCALE				24
+#define PLASMA_SPEED				8
+#define WATER_SCALE					40
+#define WATER_SPEED					12
+#define WATER_CREST					152			// Noise above this is lit towards white
+
+#define FIRECRACKER_FUSE_TICKS		40			// Length of the fuse in steps, unless modeParam sets it
+#define FIRECRACKER_FUSE_MAX		320			// Longest fuse modeParam can ask for, 20 S at 62 mS a step
+#define FIRECRACKER_BURST_TICKS		32			// Steps the sparks take to die away
+#define FIRECRACKER_DARK_TICKS		16			// Steps of darkness before the next fuse is lit
+
+enum {FIRECRACKER_FUSE, FIRECRACKER_BURST, FIRECRACKER_DARK};
+
+/*****************************************************************************
+		Prototypes
+*****************************************************************************/
+
+static void flashInit (void);
+static bool flashStep (void);
+static void rotateInit (void);
+static bool rotateStep (void);
+static void rotateParam (uint16_t modeParam);
+static void randomInit (void);
+static bool randomStep (void);
+static void randomParam (uint16_t modeParam);
+static void throbInit (void);
+static bool throbStep (void);
+static void breatheInit (void);
+static bool breatheStep (void);
+static void envelopeParam (uint16_t modeParam);
+static void envelopePattern (void);
+static void firecrackerInit (void);
+static bool firecrackerStep (void);
+static void firecrackerParam (uint16_t modeParam);
+static bool orbitalsStep (void);
+static void oneshotInit (void);
+static bool oneshotStep (void);
+static void rainbowInit (void);
+static bool rainbowStep (void);
+static void rainbowParam (uint16_t modeParam);
+static void rainbowPixel (uint16_t led, uint8_t pixel[]);
+static void fireInit (void);
+static bool fireStep (void);
+static void fireParam (uint16_t modeParam);
+static void firePixel (uint16_t led, uint8_t pixel[]);
+static void plasmaInit (void);
+static bool plasmaStep (void);
+static void plasmaParam (uint16_t modeParam);
+static void plasmaPixel (uint16_t led, uint8_t pixel[]);
+static void waterInit (void);
+static bool waterStep (void);
+static void waterParam (uint16_t modeParam);
+static void waterPixel (uint16_t led, uint8_t pixel[]);
+static void programInit (void);
+static bool programStep (void);
+static void programParam (uint16_t modeParam);
+static void programPixel (uint16_t led, uint8_t pixel[]);
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+static const FoolsEffect_t effectTable[] PROGMEM =
+{
+	[STATIC]		= { NULL,				NULL,				NULL },
+	[ROTATE]		= { rotateInit,			rotateStep,			rotateParam },
+	[FLASH]			= { flashInit,			flashStep,			NULL },
+	[RANDOM]		= { randomInit,			randomStep,			randomParam },
+	[THROB]			= { throbInit,			throbStep,			envelopeParam,		NULL,			envelopePattern },
+	[FIRECRACKER]	= { firecrackerInit,	firecrackerStep,	firecrackerParam },
+	[ORBITALS]		= { NULL,				orbitalsStep,		NULL },
+	[ONESHOT]		= { oneshotInit,		oneshotStep,		NULL },
+	[PARTICLES]		= { particlesInit,		particlesStep,		particlesParam },
+	[BREATHE]		= { breatheInit,		breatheStep,		envelopeParam,		NULL,			envelopePattern },
+	[RAINBOW]		= { rainbowInit,		rainbowStep,		rainbowParam,		rainbowPixel },
+	[FIRE]			= { fireInit,			fireStep,			fireParam,			firePixel },
+	[PLASMA]		= { plasmaInit,			plasmaStep,			plasmaParam,		plasmaPixel },
+	[WATER]			= { waterInit,			waterStep,			waterParam,			waterPixel },
+	[PROGRAM]		= { programInit,		programStep,		programParam },
+};
+
+#define EFFECT_COUNT		(sizeof(effectTable) / sizeof(effectTable[0]))
+
+static uint8_t effectMode = STATIC;
+static uint16_t effectInterval = LED_ANIMATION_INTERVAL;
+
+static ledval_t effectLine[LED_FRAME_BYTES];
+static ledval_t effectPattern[LED_FRAME_BYTES];
+static EffectState_t effectBase;
+
+ledval_t *LEDarray = effectLine;
+ledval_t *LEDpattern = effectPattern;
+EffectState_t *effectState = &effectBase;
+
+#ifdef LED_BENCHMARK
+volatile uint32_t effectBenchCycles[EFFECT_COUNT];
+volatile uint32_t effectBenchMaxCycles[EFFECT_COUNT];
+volatile uint16_t effectBenchPixelCycles[EFFECT_COUNT];
+volatile uint16_t effectBench30fps[EFFECT_COUNT];
+const uint8_t effectCount = EFFECT_COUNT;
+#endif
+
+/*****************************************************************************
+		Dispatcher
+*****************************************************************************/
+
+// Copy of the current effect's entry in effectTable[]
+static void effectLoad(uint8_t mode, FoolsEffect_t *effect)
+{
+	memcpy_P(effect, &effectTable[mode], sizeof(FoolsEffect_t));
+}
+
+void effectInitMode(uint8_t mode)
+{
+	FoolsEffect_t effect;
+
+	if (mode >= EFFECT_COUNT)
+		mode = STATIC;
+	memset(effectState, 0, sizeof(EffectState_t));
+	effectLoad(mode, &effect);
+	if (effect.init != NULL)
+		effect.init();
+}
+
+void effectParamMode(uint8_t mode, uint16_t modeParam)
+{
+	FoolsEffect_t effect;
+
+	if (mode >= EFFECT_COUNT)
+		return;
+	effectLoad(mode, &effect);
+	if (effect.param != NULL)
+		effect.param(modeParam);
+}
+
+bool effectStepMode(uint8_t mode)
+{
+	FoolsEffect_t effect;
+
+	if (mode >= EFFECT_COUNT)
+		return false;
+	effectLoad(mode, &effect);
+	return (effect.step != NULL) && effect.step();
+}
+
+void effectSelect(uint8_t mode)
+{
+	if (mode >= EFFECT_COUNT)
+		mode = STATIC;
+	effectMode = mode;
+	ledFrameSetHead(0);							// Only ROTATE turns the strip
+	effectInitMode(mode);
+}
+
+void effectParam(uint16_t modeParam)
+{
+	effectParamMode(effectMode, modeParam);
+}
+
+bool effectRepattern(void)
+{
+	FoolsEffect_t effect;
+
+	effectLoad(effectMode, &effect);
+	if (effect.pattern == NULL)
+		return false;
+	effect.pattern();
+	return true;
+}
+
+void effectSetInterval(uint16_t ms)
+{
+	effectInterval = (ms != 0) ? ms : 1;
+}
+
+void effectStep(void)
+{
+	FoolsEffect_t effect;
+	bool changed;
+
+	effectLoad(effectMode, &effect);
+	changed = (effect.step != NULL) && effect.step();
+#ifdef LED_STREAM_LEDS
+// A streamed frame is never in an array, so the layers cannot go over it
+	if (effect.pixel != NULL)
+	{
+		if (changed)
+			ledFrameStream(effect.pixel);
+		return;
+	}
+#endif
+	if (layersStep())
+		changed = true;
+	if (changed)
+		layersFrameDone();
+}
+
+#ifdef LED_BENCHMARK
+/*****************************************************************************
+	Time EFFECT_BENCH_STEPS steps of every effect, starting from the same pattern, and leave
+	the average and the slowest step in cycles in effectBenchCycles[] and effectBenchMaxCycles[].
+	The effects with a pixel function have EFFECT_BENCH_PIXELS calls of it timed as well, after
+	the steps, and that is set against the time per LED of the longest frame ledBenchmark()
+	sent, both in CPU cycles and on the wire, for the most LEDs they could keep up at 30 fps.
+	So this has to run after ledBenchmark().  The LED array and pattern are cleared again at
+	the end.
+*****************************************************************************/
+void effectBenchmark(void)
+{
+	FoolsEffect_t effect;
+	uint8_t pixel[LED_CHANNELS];
+	uint32_t start;
+	uint32_t cycles;
+	uint32_t total;
+	uint32_t slowest;
+	uint32_t sendCycles = 0;
+	uint32_t wireLEDs = 0;
+
+	benchInit();
+	for (uint8_t size=0;size<LED_BENCH_SIZES;size++)
+	{
+		if (ledBenchResults[size].numLEDs == 0)
+			continue;
+		sendCycles = ledBenchResults[size].callCycles / ledBenchResults[size].numLEDs;
+		wireLEDs = (1000000UL / 30) * ledBenchResults[size].numLEDs / ledBenchResults[size].frameTime_uS;
+	}
+	for (uint8_t mode=0;mode<EFFECT_COUNT;mode++)
+	{
+// A rainbow-ish ramp, so that no effect sees an all-dark or all-equal strip
+		for (ledindex_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr++)
+		{
+			LEDpattern[LED_ptr] = LED_VALUE((LED_ptr * 37) & 0xFF);
+			LEDarray[LED_ptr] = LEDpattern[LED_ptr];
+		}
+		effectSelect(mode);
+		effectLoad(mode, &effect);
+		total = 0;
+		slowest = 0;
+		for (uint8_t step=0;(effect.step != NULL)&&(step<EFFECT_BENCH_STEPS);step++)
+		{
+			start = benchTicks();
+			effect.step();
+			cycles = BENCH_TICKS_TO_CYCLES(benchTicks() - start);
+			total += cycles;
+			if (cycles > slowest)
+				slowest = cycles;
+		}
+		effectBenchCycles[mode] = total / EFFECT_BENCH_STEPS;
+		effectBenchMaxCycles[mode] = slowest;
+		effectBenchPixelCycles[mode] = 0;
+		effectBench30fps[mode] = 0;
+		if (effect.pixel == NULL)
+			continue;
+		start = benchTicks();
+		for (uint8_t led=0;led<EFFECT_BENCH_PIXELS;led++)
+			effect.pixel(led, pixel);
+		effectBenchPixelCycles[mode] = BENCH_TICKS_TO_CYCLES(benchTicks() - start) / EFFECT_BENCH_PIXELS;
+		cycles = (F_CPU / 30) / (effectBenchPixelCycles[mode] + sendCycles);
+		effectBench30fps[mode] = (wireLEDs != 0 && wireLEDs < cycles) ? wireLEDs : cycles;
+	}
+	memset(LEDarray, 0, LED_FRAME_BYTES * sizeof(ledval_t));
+	memset(LEDpattern, 0, LED_FRAME_BYTES * sizeof(ledval_t));
+	effectSelect(STATIC);
+}
+#endif // LED_BENCHMARK
+
+/*****************************************************************************
+		Effects
+*****************************************************************************/
+
+// Offset in LEDpattern of an LED, with the pattern repeated along a strip longer than NUM_LEDS
+static uint16_t patternOffset(uint16_t led)
+{
+	return ((led < NUM_LEDS) ? led : led % NUM_LEDS) * LED_CHANNELS;
+}
+
+// The brightest channel of an LED of the pattern, for the effects that make their own colors
+static uint8_t patternLevel(uint16_t led)
+{
+	uint16_t LED_ptr = patternOffset(led);
+	ledval_t val;
+
+	val = LEDpattern[LED_ptr+LED_RED];
+	if (LEDpattern[LED_ptr+LED_GRN] > val)
+		val = LEDpattern[LED_ptr+LED_GRN];
+	if (LEDpattern[LED_ptr+LED_BLU] > val)
+		val = LEDpattern[LED_ptr+LED_BLU];
+	return val >> LED_FRAC_BITS;
+}
+
+// An 8-bit value scaled by a level, 255 leaves it as it is
+static inline uint8_t scaleLevel(uint8_t value, uint8_t level)
+{
+	return ((uint16_t)value * (level + 1)) >> 8;
+}
+
+static void pixelSet(uint8_t pixel[], uint8_t red, uint8_t grn, uint8_t blu)
+{
+	pixel[LED_RED] = red;
+	pixel[LED_GRN] = grn;
+	pixel[LED_BLU] = blu;
+#if LED_CHANNELS == 4
+	pixel[LED_WHT] = 0;
+#endif
+}
+
+// True while the effect being stepped is the base and is streamed (see LED_STREAM_LEDS).  The
+// overlay layers point LEDarray at their own lines, so an effect on one of them never is.
+static bool effectStreamed(void)
+{
+#ifdef LED_STREAM_LEDS
+	FoolsEffect_t effect;
+
+	if (LEDarray != effectLine)
+		return false;
+	effectLoad(effectMode, &effect);
+	return effect.pixel != NULL;
+#else
+	return false;
+#endif
+}
+
+// Fills LEDarray from the pixel function of an effect.  A streamed base is drawn from it as the
+// LEDs are sent instead, so there is nothing to do, but on an overlay the layer's line still has
+// to be filled for FoolsLayers.c to blend.
+static void pixelsDraw(void (*pixel)(uint16_t led, uint8_t pixel[]))
+{
+	uint8_t values[LED_CHANNELS];
+	ledval_t *line = LEDarray;
+
+	if (effectStreamed())
+		return;
+	for (ledindex_t led=0;led<NUM_LEDS;led++)
+	{
+		pixel(led, values);
+		line[LED_RED] = LED_VALUE(values[LED_RED]);
+		line[LED_GRN] = LED_VALUE(values[LED_GRN]);
+		line[LED_BLU] = LED_VALUE(values[LED_BLU]);
+		line += LED_CHANNELS;
+	}
+}
+
+/*****************************************************************************
+	This animation simply alternates between the provided pattern and all LEDs off
+	The state keeps track of whether LEDs should be on or off on this cycle
+*****************************************************************************/
+static void flashInit(void)
+{
+	effectState->flash.state = 0;
+}
+
+static bool flashStep(void)
+{
+	ledval_t *line = LEDarray;
+
+	if (effectState->flash.state == 0)
+	{
+		effectState->flash.state = 1;
+		for (ledindex_t led=0;led<NUM_LEDS;led++)
+		{
+			line[LED_GRN] = 0;
+			line[LED_RED] = 0;
+			line[LED_BLU] = 0;
+			line += LED_CHANNELS;
+		}
+	} else
+	{
+		effectState->flash.state = 0;
+		memcpy(LEDarray,LEDpattern,LED_FRAME_BYTES * sizeof(ledval_t));
+	}
+	return true;
+}
+
+/*****************************************************************************
+	Move every LED down one place, and the first one around to the end, or as many places
+	either way as modeParam says.  LEDarray is left as it is and only the LED shown first
+	moves, so a step costs the same on any length of strip instead of moving the whole array.
+	On the base the output stage starts the strip from it (see LEDFrame.c), and on an overlay
+	FoolsLayers.c starts the blend of the layer from it, so only that layer turns.
+*****************************************************************************/
+static void rotateInit(void)
+{
+	effectState->rotate.leds = 1;
+}
+
+static void rotateParam(uint16_t modeParam)
+{
+	effectState->rotate.leds = (modeParam != 0) ? (int16_t)modeParam : 1;
+}
+
+static bool rotateStep(void)
+{
+	int16_t head = (int16_t)effectState->rotate.head + (effectState->rotate.leds % (int16_t)NUM_LEDS);
+
+	if (head < 0)
+		head += NUM_LEDS;
+	else if (head >= NUM_LEDS)
+		head -= NUM_LEDS;
+	effectState->rotate.head = head;
+	if (LEDarray == effectLine)
+		ledFrameSetHead(head);
+	return true;
+}
+
+/*****************************************************************************
+	This animation flashes the pattern at a rate determined by the freq parameter
+	Each step draws a number from 0 - 32767, so the frequency of flashes is roughly
+	freq/32768*1000/period_mS.  With RANDOM_TWINKLE in modeParam each LED draws its own
+	number, so the LEDs twinkle on their own at that rate instead of the whole strip flashing.
+*****************************************************************************/
+static void randomInit(void)
+{
+	effectState->random.freq = 512;
+	randomStream(&effectState->random.stream);
+}
+
+static void randomParam(uint16_t modeParam)
+{
+	effectState->random.freq = modeParam & ~RANDOM_TWINKLE;
+	effectState->random.twinkle = (modeParam & RANDOM_TWINKLE) != 0;
+}
+
+static bool randomStep(void)
+{
+	uint16_t freq = effectState->random.freq;
+	bool twinkle = effectState->random.twinkle;
+	bool show = (random16(&effectState->random.stream) >> 1) <= freq;
+	const ledval_t *pattern = LEDpattern;
+	ledval_t *line = LEDarray;
+
+	for (ledindex_t led=0;led<NUM_LEDS;led++)
+	{
+		if (twinkle)
+			show = (random16(&effectState->random.stream) >> 1) <= freq;
+		for (uint8_t channel=0;channel<LED_CHANNELS;channel++)
+		{
+			*line++ = show ? *pattern : 0;
+			pattern++;
+		}
+	}
+	return true;
+}
+
+/*****************************************************************************
+	THROB and BREATHE scale the pattern by an envelope from FoolsEnvelopes.c, indexed by a
+	phase that moves on by the same amount each step.  The amount is worked out from the
+	period in modeParam and the step interval, so a cycle takes the same time whatever the
+	animation timer is set to, and it is only worked out again when one of them changes.
+	Each step costs one table read and one 8x8 multiply per byte, the same every step, and
+	a step that lands on the same envelope value as the last one draws nothing.
+	A modeParam below ENVELOPE_LEGACY_DELTA is taken as the change per step of the old
+	THROB, which went from the pattern to dark and back in 512/delta steps.
+	A new pattern or period carries on from the same phase, so a command that only changes
+	the colors does not set the throb or breath back to its start.
+*****************************************************************************/
+static void envelopeStart(uint16_t period)
+{
+	effectState->envelope.period = period;
+	effectState->envelope.interval = 0;
+	effectState->envelope.level = 0xFFFF;
+}
+
+// 0 leaves the period the effect started with
+static void envelopeParam(uint16_t modeParam)
+{
+	if (modeParam == 0)
+		return;
+	effectState->envelope.period = modeParam;
+	effectState->envelope.interval = 0;
+}
+
+// The next step draws the new pattern, even at the same level
+static void envelopePattern(void)
+{
+	effectState->envelope.level = 0xFFFF;
+}
+
+static bool envelopeStep(const uint8_t *envelope)
+{
+	uint32_t increment;
+	uint16_t level;
+	uint16_t scale;
+	const ledval_t *pattern = LEDpattern;
+	ledval_t *line = LEDarray;
+
+	if (effectState->envelope.interval != effectInterval)
+	{
+		effectState->envelope.interval = effectInterval;
+		if (effectState->envelope.period < ENVELOPE_LEGACY_DELTA)
+			increment = (uint32_t)effectState->envelope.period << 7;
+		else
+			increment = ((uint32_t)effectInterval << 16) / effectState->envelope.period;
+// Any faster than half a cycle a step and it only flickers
+		if (increment > 0x8000)
+			increment = 0x8000;
+		effectState->envelope.increment = increment;
+	}
+	level = pgm_read_byte(&envelope[effectState->envelope.phase >> 8]);
+	effectState->envelope.phase += effectState->envelope.increment;
+	if (level == effectState->envelope.level)
+		return false;
+	effectState->envelope.level = level;
+	scale = level + 1;
+	for (ledindex_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr++)
+	{
+#ifdef LED_DITHER
+		*line++ = ((uint32_t)*pattern++ * scale) >> 8;
+#else
+		*line++ = ((uint16_t)*pattern++ * scale) >> 8;
+#endif
+	}
+	return true;
+}
+
+// A raised cosine, from the pattern down to dark and back
+static void throbInit(void)
+{
+	envelopeStart(THROB_PERIOD);
+}
+
+static bool throbStep(void)
+{
+	return envelopeStep(envelopeThrob);
+}
+
+// Slow in the dark and a short swell to the pattern, like breathing
+static void breatheInit(void)
+{
+	envelopeStart(BREATHE_PERIOD);
+}
+
+static bool breatheStep(void)
+{
+	return envelopeStep(envelopeBreathe);
+}
+
+/*****************************************************************************
+	A fuse burns along the strip for fuseTicks steps, leaving a glowing trail, then the
+	whole strip bursts into sparks that crackle and die away, then it stays dark for a
+	moment before the next fuse is lit.  Each step dims the whole strip a little, which
+	draws the trail and the decay, and lights at most one LED, except for the step of the
+	burst, so a step costs one pass over the strip.  It used to redraw the strip 100 times
+	a step, with a rand() and two divisions each time, and only show the last one: about
+	190000 cycles a step on 16 LEDs against about 1500 now (effectBenchCycles has the real
+	figures when LED_BENCHMARK is on).
+*****************************************************************************/
+static void firecrackerInit(void)
+{
+	effectState->firecracker.fuseTicks = FIRECRACKER_FUSE_TICKS;
+	randomStream(&effectState->firecracker.stream);
+}
+
+static void firecrackerParam(uint16_t modeParam)
+{
+	if (modeParam == 0)
+		modeParam = FIRECRACKER_FUSE_TICKS;
+// Older controllers leave the last mode's parameter here, often thousands of steps
+	else if (modeParam > FIRECRACKER_FUSE_MAX)
+		modeParam = FIRECRACKER_FUSE_MAX;
+	effectState->firecracker.fuseTicks = modeParam;
+	effectState->firecracker.phase = FIRECRACKER_FUSE;
+	effectState->firecracker.tick = 0;
+}
+
+static bool firecrackerStep(void)
+{
+	uint8_t decay = (effectState->firecracker.phase == FIRECRACKER_FUSE) ? 2 : 3;
+	uint16_t random;
+	ledindex_t LED_ptr;
+	uint8_t flicker;
+	ledval_t *line = LEDarray;
+
+// Everything dies away a little each step: a quarter along the fuse, an eighth after the burst
+	for (LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr++)
+	{
+		*line -= *line >> decay;
+		line++;
+	}
+	random = random16(&effectState->firecracker.stream);
+	switch (effectState->firecracker.phase)
+	{
+		case FIRECRACKER_FUSE:
+		{
+// The burning end of the fuse moves along the strip and flickers yellow
+			LED_ptr = (uint32_t)effectState->firecracker.tick * NUM_LEDS / effectState->firecracker.fuseTicks * LED_CHANNELS;
+			flicker = 192 + (random >> 10);
+			LEDarray[LED_ptr+LED_GRN] = LED_VALUE(flicker - (flicker >> 2));
+			LEDarray[LED_ptr+LED_RED] = LED_VALUE(flicker);
+			LEDarray[LED_ptr+LED_BLU] = 0;
+			if (++effectState->firecracker.tick >= effectState->firecracker.fuseTicks)
+			{
+				effectState->firecracker.phase = FIRECRACKER_BURST;
+				effectState->firecracker.tick = 0;
+			}
+		} break;
+		case FIRECRACKER_BURST:
+		{
+			if (effectState->firecracker.tick == 0)
+			{
+// Bang: every LED gets a spark of white, yellow or red at a random brightness
+				line = LEDarray;
+				for (LED_ptr=0;LED_ptr<NUM_LEDS;LED_ptr++)
+				{
+					random = random16(&effectState->firecracker.stream);
+					flicker = 128 + (random >> 9);
+					line[LED_RED] = LED_VALUE(flicker);
+					line[LED_GRN] = ((random & 0x03) == 0) ? 0 : LED_VALUE(flicker - (flicker >> 2));
+					line[LED_BLU] = ((random & 0x03) == 3) ? LED_VALUE(flicker) : 0;
+					line += LED_CHANNELS;
+				}
+			} else if ((random >> 8) > effectState->firecracker.tick * (256 / FIRECRACKER_BURST_TICKS))
+			{
+// Crackle: less and less often, one LED flares up again
+				LED_ptr = randomRange(&effectState->firecracker.stream, NUM_LEDS) * LED_CHANNELS;
+				LEDarray[LED_ptr+LED_GRN] = LED_VALUE(255);
+				LEDarray[LED_ptr+LED_RED] = LED_VALUE(255);
+				LEDarray[LED_ptr+LED_BLU] = LED_VALUE(255);
+			}
+			if (++effectState->firecracker.tick >= FIRECRACKER_BURST_TICKS)
+			{
+				effectState->firecracker.phase = FIRECRACKER_DARK;
+				effectState->firecracker.tick = 0;
+			}
+		} break;
+		default:
+		{
+			if (++effectState->firecracker.tick >= FIRECRACKER_DARK_TICKS)
+			{
+				effectState->firecracker.phase = FIRECRACKER_FUSE;
+				effectState->firecracker.tick = 0;
+			}
+		} break;
+	}
+	return true;
+}
+
+/*****************************************************************************
+	Looks like the throb color change, but the change is tied to the RSSI value
+	rather than a hardcoded delta
+*****************************************************************************/
+static bool orbitalsStep(void)
+{
+	ledval_t red = LED_VALUE(averageRSSI);
+	ledval_t blu = LED_VALUE(255-averageRSSI);
+	ledval_t *line = LEDarray;
+
+	for (ledindex_t led=0;led<NUM_LEDS;led++)
+	{
+		line[LED_GRN] = 0;
+		line[LED_RED] = red;
+		line[LED_BLU] = blu;
+		line += LED_CHANNELS;
+	}
+	return true;
+}
+
+/*****************************************************************************
+	Pulses the LEDs and then goes dark.  The pulse is only finished, not sent, when the
+	command comes in, and the first step can come before the next frame tick, so the step
+	leaves it alone until a tick has taken it.
+*****************************************************************************/
+static void oneshotInit(void)
+{
+	effectState->oneshot.pulseOn = true;
+}
+
+static bool oneshotStep(void)
+{
+	if (!effectState->oneshot.pulseOn || ledFramePending())
+		return false;
+	effectState->oneshot.pulseOn = false;
+	memset(LEDarray, 0, LED_FRAME_BYTES * sizeof(ledval_t));
+	return true;
+}
+
+/*****************************************************************************
+	A rainbow along the strip that turns a little each step.  The hue moves on by spread
+	from one LED to the next, and by speed each step.  The pattern only sets how bright each
+	LED is, from its brightest color, so a dark LED in the pattern stays dark, and it repeats
+	along a strip longer than NUM_LEDS.  modeParam has the spread in its low byte and the
+	speed in its high byte, 0 for the defaults.  Each LED only depends on its position, so
+	with LED_STREAM_LEDS the step just turns the wheel and rainbowPixel() draws the LEDs as
+	they are sent.
+*****************************************************************************/
+static void rainbowInit(void)
+{
+	effectState->rainbow.speed = RAINBOW_SPEED;
+	effectState->rainbow.spread = RAINBOW_SPREAD;
+}
+
+static void rainbowParam(uint16_t modeParam)
+{
+	effectState->rainbow.spread = ((modeParam & 0xFF) != 0) ? (modeParam & 0xFF) : RAINBOW_SPREAD;
+	effectState->rainbow.speed = ((modeParam >> 8) != 0) ? (int8_t)(modeParam >> 8) : RAINBOW_SPEED;
+}
+
+static void rainbowPixel(uint16_t led, uint8_t pixel[])
+{
+	RgbColor_t rgb;
+
+	hsvToRgb(effectState->rainbow.hue + (uint8_t)led * effectState->rainbow.spread, 255, patternLevel(led), &rgb);
+	pixelSet(pixel, rgb.red, rgb.grn, rgb.blu);
+}
+
+static bool rainbowStep(void)
+{
+	pixelsDraw(rainbowPixel);
+	effectState->rainbow.hue += effectState->rainbow.speed;
+	return true;
+}
+
+/*****************************************************************************
+	FIRE, PLASMA and WATER are drawn from the gradient noise of FoolsNoise.c, sampled at
+	scale 256ths of a cell from one LED to the next and moved on by speed 256ths of a cell each
+	step.  modeParam has the scale in its low byte and the speed in its high byte, 0 for each
+	effect's defaults, so a bigger scale makes smaller features and a bigger speed faster ones.
+	Like RAINBOW, the pattern only sets how bright each LED is, except that WATER takes its
+	colors from it, and with LED_STREAM_LEDS the LEDs are drawn as they are sent.
+*****************************************************************************/
+static void noiseSetup(uint16_t modeParam, uint8_t scale, uint8_t speed)
+{
+	effectState->noise.scale = ((modeParam & 0xFF) != 0) ? (modeParam & 0xFF) : scale;
+	effectState->noise.speed = ((modeParam >> 8) != 0) ? (modeParam >> 8) : speed;
+}
+
+static bool noiseStep(void (*pixel)(uint16_t led, uint8_t pixel[]))
+{
+	pixelsDraw(pixel);
+	effectState->noise.time += effectState->noise.speed;
+	return true;
+}
+
+// Flames that rise along the strip and churn as they go, through a palette from dark red to
+// yellow to white.  Only the top of the noise burns, so there is dark between the flames.
+static void fireInit(void)
+{
+	noiseSetup(0, FIRE_SCALE, FIRE_SPEED);
+}
+
+static void fireParam(uint16_t modeParam)
+{
+	noiseSetup(modeParam, FIRE_SCALE, FIRE_SPEED);
+}
+
+static void firePixel(uint16_t led, uint8_t pixel[])
+{
+	uint16_t time = effectState->noise.time;
+	uint8_t level = patternLevel(led);
+	uint8_t heat = noise2(led * effectState->noise.scale - time, time >> 1);
+	uint8_t red;
+	uint8_t grn;
+	uint8_t blu;
+
+	heat = (heat <= FIRE_FLOOR) ? 0 : ((heat >= FIRE_FLOOR + 170) ? 255 : (heat - FIRE_FLOOR) * 3 / 2);
+	red = (heat < 85) ? heat * 3 : 255;
+	grn = (heat < 85) ? 0 : ((heat < 170) ? (heat - 85) * 3 : 255);
+	blu = (heat < 170) ? 0 : (heat - 170) * 3;
+	pixelSet(pixel, scaleLevel(red, level), scaleLevel(grn, level), scaleLevel(blu, level));
+}
+
+static bool fireStep(void)
+{
+	return noiseStep(firePixel);
+}
+
+// Soft blobs of color drifting round the wheel
+static void plasmaInit(void)
+{
+	noiseSetup(0, PLASMA_SCALE, PLASMA_SPEED);
+}
+
+static void plasmaParam(uint16_t modeParam)
+{
+	noiseSetup(modeParam, PLASMA_SCALE, PLASMA_SPEED);
+}
+
+static void plasmaPixel(uint16_t led, uint8_t pixel[])
+{
+	uint16_t time = effectState->noise.time;
+	RgbColor_t rgb;
+
+// Twice the noise goes once round the wheel over most of its range
+	hsvToRgb(noise2(led * effectState->noise.scale, time) * 2 + (time >> 4), 255, patternLevel(led), &rgb);
+	pixelSet(pixel, rgb.red, rgb.grn, rgb.blu);
+}
+
+static bool plasmaStep(void)
+{
+	return noiseStep(plasmaPixel);
+}
+
+// The pattern rippling in brightness, from two octaves of noise, with the crests of the ripples
+// catching the light
+static void waterInit(void)
+{
+	noiseSetup(0, WATER_SCALE, WATER_SPEED);
+}
+
+static void waterParam(uint16_t modeParam)
+{
+	noiseSetup(modeParam, WATER_SCALE, WATER_SPEED);
+}
+
+static void waterPixel(uint16_t led, uint8_t pixel[])
+{
+	uint16_t LED_ptr = patternOffset(led);
+	uint16_t time = effectState->noise.time;
+	uint16_t x = led * effectState->noise.scale;
+	uint8_t ripple = (noise2(x, time) + noise2(x * 2, time * 2 + 0x8000)) >> 1;
+	uint8_t shade = (ripple <= 32) ? 0 : ((ripple >= 160) ? 255 : (ripple - 32) * 2);
+	uint8_t crest = (ripple > WATER_CREST) ? (ripple - WATER_CREST) * 4 : 0;
+	uint8_t level[3];
+
+	level[0] = scaleLevel(LEDpattern[LED_ptr+LED_RED] >> LED_FRAC_BITS, shade);
+	level[1] = scaleLevel(LEDpattern[LED_ptr+LED_GRN] >> LED_FRAC_BITS, shade);
+	level[2] = scaleLevel(LEDpattern[LED_ptr+LED_BLU] >> LED_FRAC_BITS, shade);
+	for (uint8_t channel=0;channel<3;channel++)
+	{
+		level[channel] = (level[channel] > 255 - crest) ? 255 : level[channel] + crest;
+	}
+	pixelSet(pixel, level[0], level[1], level[2]);
+}
+
+static bool waterStep(void)
+{
+	return noiseStep(waterPixel);
+}
+
+/*****************************************************************************
+	Runs the program last sent on LEDProg_ENDPOINT, see FoolsProgram.c.  The frame code runs
+	each step, then the pixel code for each LED.  modeParam is passed to the program.
+	It has no pixel function in effectTable[], so it is never streamed: pixel code may take up
+	to PROGRAM_MAX_STEPS instructions for each LED, far more than the gap LEDStream.c has
+	between LEDs, so it is drawn into LEDarray like the effects without one.
+*****************************************************************************/
+static void programInit(void)
+{
+	programStart(&effectState->program);
+}
+
+static void programParam(uint16_t modeParam)
+{
+	effectState->program.param = modeParam;
+}
+
+static void programPixel(uint16_t led, uint8_t pixel[])
+{
+	programRunPixel(&effectState->program, led, &LEDpattern[patternOffset(led)], pixel);
+}
+
+static bool programStep(void)
+{
+	programRunFrame(&effectState->program);
+	pixelsDraw(programPixel);
+	return true;
+}
@@ -0,0 +1,120 @@
+/*
+	Registry of the lantern animations.  Each subMode of LED_Command_t has an entry in
+	effectTable[] in FoolsEffects.c with the functions that start it, draw each step and take the
+	modeParam of a command.  Each effect keeps its state in its own member of EffectState_t, so
+	they all share the same RAM.  To add an effect, add its subMode to FoolsModes.h, its state to
+	EffectState_t and its functions to effectTable[].
+	The effects draw through LEDarray, LEDpattern and effectState, which point at the current
+	effect's line, pattern and state.  The overlay layers of FoolsLayers.c point them at their own
+	for as long as their effects run, so any effect can run on any layer.
+	An effect that can work out any LED from its position alone can also give a pixel function.
+	With LED_STREAM_LEDS its step then only moves the effect on, and the LEDs are drawn from the
+	pixel function as they are sent, with no LED array (see LEDStream.c).
+*/
+#ifndef _FOOLS_EFFECTS_H_
+#define _FOOLS_EFFECTS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "LEDFrame.h"
+#include "FoolsRandom.h"
+#include "FoolsParticles.h"
+#include "FoolsProgram.h"
+
+typedef struct FoolsEffect_t {
+	void		(*init)(void);					// Starts the effect, after LEDpattern has been set
+	bool		(*step)(void);					// Draws the next step into LEDarray, true if it changed anything
+	void		(*param)(uint16_t modeParam);	// Takes the modeParam of a command
+	void		(*pixel)(uint16_t led, uint8_t pixel[]);	// Color of one LED, for effects that can stream
+	void		(*pattern)(void);				// Takes a new LEDpattern without starting again
+} FoolsEffect_t;								// Any of them can be NULL if there is nothing to do
+
+typedef union EffectState_t {
+	struct {
+		uint8_t		state;						// 0 shows the pattern next, 1 turns the LEDs off
+	} flash;
+	struct {
+		int16_t		leds;						// LEDs to turn the strip each step, negative the other way
+		uint16_t	head;						// LED of the line shown first, 0 to NUM_LEDS - 1
+	} rotate;
+	struct {
+		uint16_t	freq;						// Out of 32768, the chance of showing the pattern each step
+		bool		twinkle;					// Each LED on its own, rather than the whole strip
+		RandomStream_t	stream;
+	} random;
+	struct {
+		uint16_t	phase;						// Position in the envelope, 65536 is one cycle
+		uint16_t	increment;					// Added to phase each step
+		uint16_t	period;						// mS for one cycle, from modeParam
+		uint16_t	interval;					// Step interval that increment was worked out for
+		uint16_t	level;						// Envelope value last drawn, above 255 if none yet
+	} envelope;									// THROB and BREATHE
+	struct {
+		uint8_t		phase;						// Fuse burning, sparks bursting or dark
+		uint16_t	tick;						// Steps into the phase
+		uint16_t	fuseTicks;					// Length of the fuse, from modeParam
+		RandomStream_t	stream;					// Spark positions and colors
+	} firecracker;
+	struct {
+		bool		pulseOn;					// The pulse is showing and goes dark next step
+	} oneshot;
+	struct {
+		uint8_t		hue;						// Hue of the first LED
+		int8_t		speed;						// Hue change each step, negative turns the wheel back
+		uint8_t		spread;						// Hue change from one LED to the next
+	} rainbow;
+	struct {
+		uint16_t	time;						// How far the noise has moved, 8.8 cells
+		uint8_t		scale;						// 256ths of a cell from one LED to the next
+		uint8_t		speed;						// 256ths of a cell the noise moves each step
+	} noise;									// FIRE, PLASMA and WATER
+	ProgramState_t	program;					// See FoolsProgram.h
+	ParticleState_t	particles;					// The biggest, see FoolsParticles.h
+} EffectState_t;
+
+extern ledval_t *LEDarray;						// LED_FRAME_BYTES values the effects draw into, see LEDFrame.h
+extern ledval_t *LEDpattern;					// Pattern from the last command
+extern EffectState_t *effectState;
+extern uint8_t averageRSSI;						// Kept up to date by FoolsLantern.c for ORBITALS
+
+// Starts the effect for a subMode.  LEDpattern should be set up first.
+extern void effectSelect (uint8_t mode);
+
+// Passes a command's modeParam to the current effect
+extern void effectParam (uint16_t modeParam);
+
+// Tells the current effect that LEDpattern has changed.  False if it cannot carry on with the
+// new one, and has to be started again with effectSelect().
+extern bool effectRepattern (void);
+
+// Tells the effects how many mS there are between steps, for the ones that keep time
+extern void effectSetInterval (uint16_t ms);
+
+// Draws the next step of the current effect and the layers over it, and hands the frame to
+// ledFrameDone() if it changed
+extern void effectStep (void);
+
+// The same for an effect that is not the current one, on whatever effectState, LEDarray and
+// LEDpattern point at.  FoolsLayers.c runs the overlay layers with these.
+extern void effectInitMode (uint8_t mode);
+extern void effectParamMode (uint8_t mode, uint16_t modeParam);
+extern bool effectStepMode (uint8_t mode);
+
+#ifdef LED_BENCHMARK
+#define EFFECT_BENCH_STEPS		64				// Steps of each effect timed by effectBenchmark()
+
+#define EFFECT_BENCH_PIXELS		64				// Calls of each pixel function timed by effectBenchmark()
+
+// Average and slowest step of each effect in CPU cycles, by subMode, for effectCount subModes.
+// For the effects with a pixel function, also the cycles per LED and the most LEDs that could be
+// drawn and sent at 30 fps, 0 for the others.  See FoolsEffects.c.
+extern volatile uint32_t effectBenchCycles[];
+extern volatile uint32_t effectBenchMaxCycles[];
+extern volatile uint16_t effectBenchPixelCycles[];
+extern volatile uint16_t effectBench30fps[];
+extern const uint8_t effectCount;
+
+extern void effectBenchmark (void);
+#endif
+
+#endif // _FOOLS_EFFECTS_H_
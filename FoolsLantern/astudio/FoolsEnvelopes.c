@@ -0,0 +1,61 @@
+/*
+ * \file FoolsEnvelopes.c
+ *
+ * \brief Brightness envelopes for THROB and BREATHE
+ *
+ *	One cycle of each envelope in 256 steps, 0 to 255.  The effects index them with the top
+ *	8 bits of a 16-bit phase, so the period is set by how far the phase moves each step.
+ *	envelopeThrob[] is a raised cosine, starting at full brightness.  envelopeBreathe[] is
+ *	e^(-cos) scaled to 0 - 255, starting dark: it lingers near dark and swells to a short
+ *	peak, which looks more like breathing than a plain sine does.
+ */
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "FoolsEnvelopes.h"
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+// 127.5 + 127.5 * cos(2 * pi * i / 256), rounded
+const uint8_t envelopeThrob[256] PROGMEM =
+{
+	255, 255, 255, 255, 254, 254, 254, 253, 253, 252, 251, 250, 250, 249, 248, 246,
+	245, 244, 243, 241, 240, 238, 237, 235, 234, 232, 230, 228, 226, 224, 222, 220,
+	218, 215, 213, 211, 208, 206, 203, 201, 198, 196, 193, 190, 188, 185, 182, 179,
+	176, 173, 170, 167, 165, 162, 158, 155, 152, 149, 146, 143, 140, 137, 134, 131,
+	128, 124, 121, 118, 115, 112, 109, 106, 103, 100,  97,  93,  90,  88,  85,  82,
+	 79,  76,  73,  70,  67,  65,  62,  59,  57,  54,  52,  49,  47,  44,  42,  40,
+	 37,  35,  33,  31,  29,  27,  25,  23,  21,  20,  18,  17,  15,  14,  12,  11,
+	 10,   9,   7,   6,   5,   5,   4,   3,   2,   2,   1,   1,   1,   0,   0,   0,
+	  0,   0,   0,   0,   1,   1,   1,   2,   2,   3,   4,   5,   5,   6,   7,   9,
+	 10,  11,  12,  14,  15,  17,  18,  20,  21,  23,  25,  27,  29,  31,  33,  35,
+	 37,  40,  42,  44,  47,  49,  52,  54,  57,  59,  62,  65,  67,  70,  73,  76,
+	 79,  82,  85,  88,  90,  93,  97, 100, 103, 106, 109, 112, 115, 118, 121, 124,
+	127, 131, 134, 137, 140, 143, 146, 149, 152, 155, 158, 162, 165, 167, 170, 173,
+	176, 179, 182, 185, 188, 190, 193, 196, 198, 201, 203, 206, 208, 211, 213, 215,
+	218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 238, 240, 241, 243, 244,
+	245, 246, 248, 249, 250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255
+};
+
+// (e^(-cos(2 * pi * i / 256)) - 1/e) / (e - 1/e) * 255, rounded
+const uint8_t envelopeBreathe[256] PROGMEM =
+{
+	  0,   0,   0,   0,   0,   0,   0,   1,   1,   1,   1,   1,   2,   2,   2,   3,
+	  3,   4,   4,   4,   5,   6,   6,   7,   7,   8,   9,   9,  10,  11,  12,  13,
+	 14,  15,  16,  17,  18,  19,  20,  21,  22,  24,  25,  26,  28,  29,  31,  32,
+	 34,  36,  38,  39,  41,  43,  45,  47,  49,  52,  54,  56,  58,  61,  63,  66,
+	 69,  71,  74,  77,  80,  83,  86,  89,  92,  95,  98, 102, 105, 109, 112, 116,
+	119, 123, 126, 130, 134, 138, 142, 145, 149, 153, 157, 161, 165, 169, 172, 176,
+	180, 184, 188, 191, 195, 199, 202, 206, 209, 213, 216, 219, 222, 225, 228, 231,
+	233, 236, 238, 240, 243, 245, 246, 248, 249, 251, 252, 253, 254, 254, 255, 255,
+	255, 255, 255, 254, 254, 253, 252, 251, 249, 248, 246, 245, 243, 240, 238, 236,
+	233, 231, 228, 225, 222, 219, 216, 213, 209, 206, 202, 199, 195, 191, 188, 184,
+	180, 176, 172, 169, 165, 161, 157, 153, 149, 145, 142, 138, 134, 130, 126, 123,
+	119, 116, 112, 109, 105, 102,  98,  95,  92,  89,  86,  83,  80,  77,  74,  71,
+	 69,  66,  63,  61,  58,  56,  54,  52,  49,  47,  45,  43,  41,  39,  38,  36,
+	 34,  32,  31,  29,  28,  26,  25,  24,  22,  21,  20,  19,  18,  17,  16,  15,
+	 14,  13,  12,  11,  10,   9,   9,   8,   7,   7,   6,   6,   5,   4,   4,   4,
+	  3,   3,   2,   2,   2,   1,   1,   1,   1,   1,   0,   0,   0,   0,   0,   0
+};
@@ -0,0 +1,13 @@
+/*
+	Envelope tables for the effects that pulse the pattern, see FoolsEnvelopes.c
+*/
+#ifndef _FOOLS_ENVELOPES_H_
+#define _FOOLS_ENVELOPES_H_
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+extern const uint8_t envelopeThrob[256] PROGMEM;
+extern const uint8_t envelopeBreathe[256] PROGMEM;
+
+#endif // _FOOLS_ENVELOPES_H_
@@ -18,6 +18,16 @@
 #include "nwk.h"
 #include "sysTimer.h"
 #include "FoolsModes.h"
+#include "LEDDriver.h"
+#include "LEDBench.h"
+#include "LEDFrame.h"
+#include "FoolsEffects.h"
+#include "FoolsRandom.h"
+#include "FoolsColor.h"
+#include "FoolsShow.h"
+#include "FoolsLayers.h"
+#include "FoolsNoise.h"
+#include "FoolsProgram.h"
 
 /*****************************************************************************
  Preprocessor definitions
@@ -28,6 +38,9 @@
 #else
 #define APP_BUFFER_SIZE     NWK_MAX_PAYLOAD_SIZE
 #endif
+
+#define THROB_LOCAL_PERIOD			32000		// mS for one throb of the local preset when it starts
+#define THROB_LOCAL_MIN_PERIOD		5000		// The local preset speeds up until it throbs this fast
 /*****************************************************************************
 		Type definitions
 *****************************************************************************/
@@ -48,11 +61,14 @@ typedef enum AppState_t
 		Function prototypes
 *****************************************************************************/
 
-extern void updateLEDs (uint8_t colorArray[], uint16_t numLEDs);
 extern void outPortE (uint8_t diagInfo);
 
 static void appSendAddr(void);
 static void appAddrCheckSendData(void);
+static void animationInterval(uint16_t ms);
+static void cmdPattern(ledval_t pattern[]);
+static bool cmdRepeated(const LED_Command_t *running);
+static void cmdLayersClear(void);
 
 
 /*****************************************************************************
@@ -72,6 +88,7 @@ static SYS_Timer_t animationTimer;
 static SYS_Timer_t accelerationTimer;
 static SYS_Timer_t cmdTimer;
 static SYS_Timer_t channelTimer;
+static SYS_Timer_t frameTimer;
 static NWK_DataReq_t appDataReq;
 static NWK_DataReq_t appSyncReq;
 static bool appDataReqBusy = false;
@@ -85,28 +102,17 @@ static uint16_t targetAddr;
 static uint8_t currentChannel;
 
 static LED_Command_t *cmdBuffer;
-static int	cmdBufferPtr;
-static uint8_t tempRed;
-static uint8_t tempGrn;
-static uint8_t tempBlu;
-static uint8_t flashState;
-static uint16_t randomPtr;
-static uint16_t randomFreq;
-static uint8_t throbDelta;
-static uint8_t throbSum;
-static uint8_t throbFade;
+static uint8_t cmdBufferPtr;
+static LED_Command_t cmdRunning;			// The last command that started the base effect
+static bool cmdRunningValid;				// False once something else has changed the base effect
+static LED_Command_t cmdLayer[LAYER_COUNT - 1];	// The last command that started each overlay layer
+static bool cmdLayerValid[LAYER_COUNT - 1];	// False once the layers have been taken off
 static uint8_t throbTimerAccel;
-static uint8_t fuse;
-static uint8_t fuseChange;
-static uint16_t animationTimerPeriod;
-static bool pulseOn;
 static bool syncOn;
 
-static uint8_t LEDarray[NUM_LEDS*3];
-static uint8_t LEDpattern[NUM_LEDS*3];
 static uint8_t currentLEDmode;
 static uint8_t latestRSSI;
-static uint8_t averageRSSI;			//to save previous value, this might need to be global
+uint8_t averageRSSI;				//to save previous value, used by the ORBITALS effect
 
 static uint16_t mainLoopBlink;
 static uint16_t debug1Blink;
@@ -183,20 +189,23 @@ static void appSendSync(void)
 	syncOn = true;
 // Set the mode to locked to command node
 	appState = APP_STATE_LOCAL;
+	showStop();
+	cmdLayersClear();
 // Sync mode is preset local accelerating throb
-	currentLEDmode = THROB;
-	throbDelta = 2;
-	throbFade = 1;
-	for (int LED_ptr=0;LED_ptr<NUM_LEDS*3;LED_ptr+=3)
+	for (ledindex_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr+=LED_CHANNELS)
 	{
-		LEDarray[LED_ptr] = 0;				// Green
-		LEDpattern[LED_ptr] = 0;			// Green
-		LEDarray[LED_ptr+1] = 0;			// Red
-		LEDpattern[LED_ptr+1] = 0;			// Red
-		LEDarray[LED_ptr+2] = 196;			// Blue
-		LEDpattern[LED_ptr+2] = 196;		// Blue
+		LEDarray[LED_ptr+LED_GRN] = 0;				// Green
+		LEDpattern[LED_ptr+LED_GRN] = 0;			// Green
+		LEDarray[LED_ptr+LED_RED] = 0;			// Red
+		LEDpattern[LED_ptr+LED_RED] = 0;			// Red
+		LEDarray[LED_ptr+LED_BLU] = LED_VALUE(196);		// Blue
+		LEDpattern[LED_ptr+LED_BLU] = LED_VALUE(196);	// Blue
 	}
-	animationTimer.interval = 125;
+	currentLEDmode = THROB;
+	cmdRunningValid = false;
+	effectSelect(THROB);
+	effectParam(THROB_LOCAL_PERIOD);
+	animationInterval(LED_ANIMATION_INTERVAL);
 	throbTimerAccel = 1;
 
 }
@@ -208,27 +217,79 @@ static void addrCheckTimerHandler(SYS_Timer_t *timer)
 }
 
 /*****************************************************************************
+	Callback function from the timer subsystem, every ACCELERATION_INTERVAL.  While the
+	sync or local preset is throbbing, its period is shortened by 1/32 each time, from
+	THROB_LOCAL_PERIOD down to THROB_LOCAL_MIN_PERIOD, and the throb keeps its phase.
 *****************************************************************************/
 static void accelerationTimerHandler(SYS_Timer_t *timer)
 {
+	uint16_t period = effectState->envelope.period;
+
 	if (currentLEDmode == THROB)
 	{
-		if (throbTimerAccel != 0)		// Update the throb period if accelerating
+		if ((throbTimerAccel != 0) && (period > THROB_LOCAL_MIN_PERIOD))		// Shorten the throb if accelerating
 		{
-			if (animationTimerPeriod > 50)
-			{
-				animationTimerPeriod -= throbTimerAccel;
-				if (animationTimerPeriod < 50)
-				animationTimerPeriod = 50;
-				animationTimer.interval = animationTimerPeriod;
-			} else if (throbDelta < 5)
-			{
-				throbDelta++;
-			}
+			period -= period >> 5;
+			if (period < THROB_LOCAL_MIN_PERIOD)
+				period = THROB_LOCAL_MIN_PERIOD;
+			effectParam(period);
 		}
 	}
 }
 
+/*****************************************************************************
+	Set the time between animation steps, and tell the effects that keep time
+*****************************************************************************/
+static void animationInterval(uint16_t ms)
+{
+	animationTimer.interval = ms;
+	effectSetInterval(ms);
+}
+
+/*****************************************************************************
+	Fill a pattern with the colors of the command.  The command carries CMD_NUM_LEDS colors,
+	which repeat along the strip if it is longer than that.
+*****************************************************************************/
+static void cmdPattern(ledval_t pattern[])
+{
+	cmdBufferPtr = 0;
+	for (ledindex_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr+=LED_CHANNELS)
+	{
+		pattern[LED_ptr+LED_GRN] = LED_VALUE(cmdBuffer->grnIntensity[cmdBufferPtr]);		// Green
+		pattern[LED_ptr+LED_RED] = LED_VALUE(cmdBuffer->redIntensity[cmdBufferPtr]);		// Red
+		pattern[LED_ptr+LED_BLU] = LED_VALUE(cmdBuffer->bluIntensity[cmdBufferPtr]);		// Blue
+		cmdBufferPtr++;
+		if (cmdBufferPtr >= CMD_NUM_LEDS)
+			cmdBufferPtr = 0;
+	}
+}
+
+/*****************************************************************************
+	True if the command is the one a layer is already running, the base or an overlay.  The
+	controller sends its command again every APP_SEND_TIMER_INTERVAL, and starting it again
+	each time would fade the LEDs into themselves and set the effect back to its first step.
+	ONESHOT is always started again, as each one is a shot.
+*****************************************************************************/
+static bool cmdRepeated(const LED_Command_t *running)
+{
+	if (cmdBuffer->subMode == ONESHOT)
+		return false;
+	if ((cmdBuffer->subMode != running->subMode) || (cmdBuffer->modeParam != running->modeParam))
+		return false;
+	return (memcmp(cmdBuffer->redIntensity, running->redIntensity, CMD_NUM_LEDS) == 0)
+		&& (memcmp(cmdBuffer->grnIntensity, running->grnIntensity, CMD_NUM_LEDS) == 0)
+		&& (memcmp(cmdBuffer->bluIntensity, running->bluIntensity, CMD_NUM_LEDS) == 0);
+}
+
+/*****************************************************************************
+	Take all the overlay layers off, and forget the commands that started them
+*****************************************************************************/
+static void cmdLayersClear(void)
+{
+	layersClear();
+	memset(cmdLayerValid, 0, sizeof(cmdLayerValid));
+}
+
 /*****************************************************************************
 	Callback function from the timer subsystem.  The timer is set to periodically
 	invoke this function when scanning for a channel with a controller on it.
@@ -256,21 +317,29 @@ static void cmdTimerHandler(SYS_Timer_t *timer)
 	{
 		appState = APP_STATE_LOCAL;
 		SYS_TimerStart(&channelTimer);
+		cmdLayersClear();
+#ifdef LOCAL_SHOW
+//		Play the local show from the frame timer, unless it is already playing from the last timeout
+		if (!showRunning())
+			showStart();
+#else
 //		Put the LEDs to sleep to save power
-		currentLEDmode = THROB;
-		throbDelta = 2;
-		throbFade = 1;
-		for (int LED_ptr=0;LED_ptr<NUM_LEDS*3;LED_ptr+=3)
+		for (ledindex_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr+=LED_CHANNELS)
 		{
-			LEDarray[LED_ptr] = 0;				// Green
-			LEDpattern[LED_ptr] = 0;			// Green
-			LEDarray[LED_ptr+1] = 0;			// Red
-			LEDpattern[LED_ptr+1] = 0;			// Red
-			LEDarray[LED_ptr+2] = 196;			// Blue
-			LEDpattern[LED_ptr+2] = 196;		// Blue
+			LEDarray[LED_ptr+LED_GRN] = 0;				// Green
+			LEDpattern[LED_ptr+LED_GRN] = 0;			// Green
+			LEDarray[LED_ptr+LED_RED] = 0;			// Red
+			LEDpattern[LED_ptr+LED_RED] = 0;			// Red
+			LEDarray[LED_ptr+LED_BLU] = LED_VALUE(196);		// Blue
+			LEDpattern[LED_ptr+LED_BLU] = LED_VALUE(196);	// Blue
 		}
-		animationTimer.interval = 125;
+		currentLEDmode = THROB;
+		cmdRunningValid = false;
+		effectSelect(THROB);
+		effectParam(THROB_LOCAL_PERIOD);
+		animationInterval(LED_ANIMATION_INTERVAL);
 		throbTimerAccel = 1;
+#endif
 // Otherwise, the flag was reset by a command that was received.  In this case, the flag
 // is set again to see if a command is received in the next timer interval.  So the node
 // is periodically checking to see that some command has been received from outside in
@@ -283,201 +352,54 @@ static void cmdTimerHandler(SYS_Timer_t *timer)
 }
 
 /*****************************************************************************
-	Callback function from the timer subsystem.  The timer is set to periodically
-	invoke this function to update the LED pattern according to the current mode.
+	Start a keyframe of the local show the same way as a command, with the pattern,
+	period and fade it carries
 *****************************************************************************/
-static void appLEDAnimationTimerHandler(SYS_Timer_t *timer)
+static void showKeyframe(const ShowKey_t *key)
 {
-	switch(currentLEDmode)
-	{
-		case STATIC:
-		{
-//			If the pattern is static (no animation) then there's nothing to do			
-		} break;
-		case FLASH:
-		{
-//			This animation simply alternates between the provided pattern and all LEDs off
-//			The flashState variable keeps track of whether LEDs should be on or off on this cycle
-			if (flashState == 0)
-			{
-				flashState = 1;
-				for (int LED_ptr=0;LED_ptr<NUM_LEDS*3;LED_ptr+=3)
-				{
-					LEDarray[LED_ptr] = 0;
-					LEDarray[LED_ptr+1] = 0;
-					LEDarray[LED_ptr+2] = 0;
-				}
-			} else
-			{
-				flashState = 0;
-				memcpy(LEDarray,LEDpattern,NUM_LEDS*3);
-			}
-
-			updateLEDs(LEDarray, NUM_LEDS*3);
-		} break;
-		case ROTATE:
-		{
-			tempGrn = LEDarray[0];
-			tempRed = LEDarray[1];
-			tempBlu = LEDarray[2];
-			for (int LED_ptr=0;LED_ptr<NUM_LEDS*3;LED_ptr+=3)
-			{
-				LEDarray[LED_ptr] = LEDarray[LED_ptr+3];
-				LEDarray[LED_ptr+1] = LEDarray[LED_ptr+4];
-				LEDarray[LED_ptr+2] = LEDarray[LED_ptr+5];
-			}
-			LEDarray[(NUM_LEDS*3)-3] = tempGrn;
-			LEDarray[(NUM_LEDS*3)-2] = tempRed;
-			LEDarray[(NUM_LEDS*3)-1] = tempBlu;
-
-			updateLEDs(LEDarray, NUM_LEDS*3);
-		} break;
-		case THROB:
-		{
-//			This animation will make the pattern grow and fade in intensity to make a throbbing
-//			effect.  The rate is set by the throbDelta parameter.  Current implementation just
-//			keeps subtracting the delta value from the color intensities and lets the values wrap
-//			around.  This has the effect of changing the color as well as the overall intensity.
-			throbSum = 0;
-//			The throbState variable indicates whether this is the build or fade direction.  
-//			throbState = 0 means that the direction is build, so the intensity of each color is
-//			reduced by the throbDelta amount until it is zero.
-			if (throbFade > 0)
-			{
-				for (int LED_ptr=0;LED_ptr<NUM_LEDS*3;LED_ptr++)
-				{
-					if (LEDarray[LED_ptr] >= throbDelta)
-					{
-						LEDarray[LED_ptr] -= throbDelta;
-						throbSum++;
-					} else {
-						LEDarray[LED_ptr] = 0;
-					}
-				}
-				if (throbSum == 0)		// Check if any changes were made this pass
-				{
-					throbFade = 0;		// When all LEDs are off, switch direction to build
-				}
-			} else {
-				for (int LED_ptr=0;LED_ptr<NUM_LEDS*3;LED_ptr++)
-				{
-					if ((LEDpattern[LED_ptr] - LEDarray[LED_ptr]) > throbDelta)
-					{
-						LEDarray[LED_ptr] += throbDelta;
-						throbSum++;		// Increment the counter for each LED color that is changed
-					} else {
-						LEDarray[LED_ptr] = LEDpattern[LED_ptr];
-					}
-				}
-				if (throbSum == 0)		// Check if any changes were made this pass
-				{
-					throbFade = 1;		// When all LEDs are at target brightness, switch direction to fade
-				}
-			}
-			updateLEDs(LEDarray, NUM_LEDS*3);
-		} break;
-		case RANDOM:
-		{
-//			This animation flashes the pattern at a rate determined by the randomFreq parameter
-//			Since the range of values from the random number generator is 0 - 32767, the frequency
-//			of flashes is roughly randomFreq/32768*1000/period_mS.
-			randomPtr = rand();
-			if (randomPtr <= randomFreq)
-			{
-				memcpy(LEDarray,LEDpattern,NUM_LEDS*3);
-			} else
-			{
-				for (int LED_ptr=0;LED_ptr<NUM_LEDS*3;LED_ptr+=3)
-				{
-					LEDarray[LED_ptr] = 0;
-					LEDarray[LED_ptr+1] = 0;
-					LEDarray[LED_ptr+2] = 0;
-				}
-			}			
+	animationInterval(key->period_mS);
+	ledFrameFade((uint32_t)key->fade * SHOW_TIME_MS / LED_FRAME_INTERVAL);
+	showPattern(key);
+	ledFrameDone(LEDarray);
+	currentLEDmode = key->subMode;
+	cmdRunningValid = false;
+	throbTimerAccel = 0;
+	effectSelect(currentLEDmode);
+	effectParam(key->modeParam);
+}
 
-			updateLEDs(LEDarray, NUM_LEDS*3);
-		} break;
-		case FIRECRACKER:
-		{
-//			fuse hopefully regulates how long the pattern lasts
-			fuse = 100;
-			fuseChange = 0;
+/*****************************************************************************
+	Callback function from the timer subsystem.  The timer is set to periodically
+	invoke this function to send the last frame the animation finished to the LEDs.
+	This is the only place the LEDs are sent from, so they go out at a steady rate
+	whatever the other timers and the network are doing.  The local show keeps time
+	from it too.
+*****************************************************************************/
+static void frameTimerHandler(SYS_Timer_t *timer)
+{
+	ShowKey_t key;
 
-			while(fuse > 0)
-			{
-//				start at yellow
-				fuseChange = 0;
-				for(int LED_ptr=0; LED_ptr<NUM_LEDS*3; LED_ptr+=3)
-				{
-					LEDarray[LED_ptr] = 170 + fuseChange;		// Grn
-					LEDarray[LED_ptr+1] = 175 + fuseChange;		// Red
-					LEDarray[LED_ptr+2] = 0;					// Blu
-				}
-//				incr change by 5, going toward white
-				fuseChange+=5;
-//				use bounded rand to insert random blips of red sparks
-//				insert random pops! (with a few guaranteed pops)
-				if(fuse == (rand() % fuse) || fuse % 13 == 0)
-				{
-//					every 3rd LED
-					for(int LED_ptr=0; LED_ptr<NUM_LEDS*3; LED_ptr+=3)
-					{
-						LEDarray[LED_ptr] = 0;		// Grn
-						LEDarray[LED_ptr+1] = 255;	// red
-						LEDarray[LED_ptr+2] = 0;	//blu
-					}
-				}
-				fuse--;
-			}
+	if (showTick(&key))
+		showKeyframe(&key);
+	ledFrameTick();
+	programSaveTick();
+}
 
-			updateLEDs(LEDarray, NUM_LEDS*3);
-		} break;
-		case ORBITALS:
-		{
-//			(looks like throb color change, but change is tied to RSSI value change rather than hardcoded delta)
-//			check to see if signal is getting closer or farther
-			for (int LED_ptr=0;LED_ptr<NUM_LEDS*3;LED_ptr+=3)
-			{
-				LEDarray[LED_ptr] = 0;
-				LEDarray[LED_ptr+1] = averageRSSI;
-				LEDarray[LED_ptr+2] = 255-averageRSSI;
-			}
+/*****************************************************************************
+	Callback function from the timer subsystem.  The timer is set to periodically
+	invoke this function to update the LED pattern according to the current mode.
+	The effects themselves are in FoolsEffects.c.
+*****************************************************************************/
+static void appLEDAnimationTimerHandler(SYS_Timer_t *timer)
+{
+#ifdef LED_BENCHMARK
+	uint32_t start = benchTicks();
+#endif
 
-/*
-			if(latestRSSI > prevRSSI) //getting closer
-			{
-				for(int LED_ptr=0; LED_ptr<NUM_LEDS*3; LED_ptr +=3)
-				{
-					LEDarray[LED_ptr] += latestRSSI;
-				}
-			} else
-			{
-				for(int LED_ptr=0; LED_ptr<NUM_LEDS*3; LED_ptr +=3)
-				{
-					LEDarray[LED_ptr] -= latestRSSI;
-				}
-			}
-*/
-			updateLEDs(LEDarray, NUM_LEDS*3);
-		} break;
-// This is a simple pulse mode
-		case ONESHOT:
-		{
-			// Pulses the LEDs and then goes dark
-			if(pulseOn) //getting closer
-			{
-				pulseOn = false;
-				for(int LED_ptr=0; LED_ptr<NUM_LEDS*3; LED_ptr++)
-				{
-					LEDarray[LED_ptr] = 0;
-				}
-				updateLEDs(LEDarray, NUM_LEDS*3);
-			}
-		} break;
-//		This default case should never be executed if all of the modes have been implemented!
-		default:
-			break;
-	}
+	effectStep();
+#ifdef LED_BENCHMARK
+	ledBenchRenderCycles = BENCH_TICKS_TO_CYCLES(benchTicks() - start);
+#endif
 }
 
 /*****************************************************************************
@@ -493,6 +415,9 @@ static bool LEDCmdDataInd(NWK_DataInd_t *ind)
 // Copy the data from the message buffer into the command buffer so that the
 // network buffer can be freed up and re-used
 	memcpy(appWorkingBuffer, ind->data, ind->size);
+// A controller from before fade_mS sends a shorter command, and gets a cut
+	if (ind->size < sizeof(LED_Command_t))
+		memset(&appWorkingBuffer[ind->size], 0, sizeof(LED_Command_t) - ind->size);
 //	debugStart = ind->size;
 	nwkState = NWK_STATE_RECD;
 	appState = APP_STATE_DATARDY;
@@ -505,6 +430,18 @@ static bool LEDCmdDataInd(NWK_DataInd_t *ind)
 	return true;
 }
 
+/*****************************************************************************
+	Callback function from the network stack for the effect program endpoint.  The chunks
+	of a program are put together in FoolsProgram.c, and the PROGRAM subMode runs it.
+*****************************************************************************/
+static bool LEDProgDataInd(NWK_DataInd_t *ind)
+{
+// The controller is still there, even if it is only sending a program
+	cmdTimeout = false;
+	programReceive((const LED_Program_t *)ind->data, ind->size);
+	return true;
+}
+
 /*****************************************************************************
 	Callback function from the network stack for the start / sync command
 *****************************************************************************/
@@ -515,20 +452,23 @@ static bool SyncDataInd(NWK_DataInd_t *ind)
 	syncOn = true;
 // Set the mode to locked to command node
 	appState = APP_STATE_LOCAL;
+	showStop();
+	cmdLayersClear();
 // Sync mode is preset to local accelerating throb
-	currentLEDmode = THROB;
-	throbDelta = 2;
-	throbFade = 1;
-	for (int LED_ptr=0;LED_ptr<NUM_LEDS*3;LED_ptr+=3)
+	for (ledindex_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr+=LED_CHANNELS)
 	{
-		LEDarray[LED_ptr] = 0;				// Green
-		LEDpattern[LED_ptr] = 0;			// Green
-		LEDarray[LED_ptr+1] = 0;			// Red
-		LEDpattern[LED_ptr+1] = 0;			// Red
-		LEDarray[LED_ptr+2] = 196;			// Blue
-		LEDpattern[LED_ptr+2] = 196;		// Blue
+		LEDarray[LED_ptr+LED_GRN] = 0;				// Green
+		LEDpattern[LED_ptr+LED_GRN] = 0;			// Green
+		LEDarray[LED_ptr+LED_RED] = 0;			// Red
+		LEDpattern[LED_ptr+LED_RED] = 0;			// Red
+		LEDarray[LED_ptr+LED_BLU] = LED_VALUE(196);		// Blue
+		LEDpattern[LED_ptr+LED_BLU] = LED_VALUE(196);	// Blue
 	}
-	animationTimer.interval = 125;
+	currentLEDmode = THROB;
+	cmdRunningValid = false;
+	effectSelect(THROB);
+	effectParam(THROB_LOCAL_PERIOD);
+	animationInterval(LED_ANIMATION_INTERVAL);
 	throbTimerAccel = 1;
 
 // Returning "true" to the network stack says that this message should be acknowledged
@@ -631,8 +571,9 @@ static void appInit(void)
 #else
 	myAddr = APP_ADDR;
 #endif
-// Set the seed for the random number generator using the local address
+// Set the seed for the random number generators using the local address
 	srand(myAddr);
+	randomSeed(myAddr);
 // Set up the system and network for the application
 	NWK_SetAddr(myAddr);
 	NWK_SetPanId(APP_PANID);
@@ -641,6 +582,7 @@ static void appInit(void)
 	PHY_SetRxState(true);
 	NWK_OpenEndpoint(LEDCmd_ENDPOINT, LEDCmdDataInd);
 	NWK_OpenEndpoint(SyncCmd_ENDPOINT, SyncDataInd);
+	NWK_OpenEndpoint(LEDProg_ENDPOINT, LEDProgDataInd);
 // Implement a periodic timer to check for duplicate addresses in the mesh
 	addrCheckTimer.interval = ADDR_CHECK_INTERVAL;
 	addrCheckTimer.mode = SYS_TIMER_PERIODIC_MODE;
@@ -661,12 +603,17 @@ static void appInit(void)
 	animationTimer.mode = SYS_TIMER_PERIODIC_MODE;
 	animationTimer.handler = appLEDAnimationTimerHandler;
 	SYS_TimerStart(&animationTimer);
-// Implement the timer to determine when to switch to local mode if
-// no commands are received.
+// Implement the timer that sends each finished frame to the LEDs.  With LED_DITHER it
+// also keeps the dithered output going between animation steps.
+	frameTimer.interval = LED_FRAME_INTERVAL;
+	frameTimer.mode = SYS_TIMER_PERIODIC_MODE;
+	frameTimer.handler = frameTimerHandler;
+	SYS_TimerStart(&frameTimer);
+// Implement the timer that speeds up the throb of the sync and local preset
 	accelerationTimer.interval = ACCELERATION_INTERVAL;
 	accelerationTimer.mode = SYS_TIMER_PERIODIC_MODE;
 	accelerationTimer.handler = accelerationTimerHandler;
-	SYS_TimerStart(&cmdTimer);
+	SYS_TimerStart(&accelerationTimer);
 // Implement the timer to determine the time between channels when scanning
 // for a controller.
 	channelTimer.interval = CHANNEL_SCAN_INTERVAL;
@@ -701,20 +648,30 @@ static void appInit(void)
 	debug4Blink = 0;
 // Initialize the animation variables / parameters.  That way if a parameter is not provided
 // via the command message, there is a default value for it.
-//		Default to static / fixed mode to start
+//		Default to static / fixed mode to start.  Each effect sets its own defaults when it starts.
 	currentLEDmode = STATIC;
-//		For the random mode(s)
-	randomFreq = 512;
-//		For the throb mode
-	throbDelta = 4;
+	effectSelect(currentLEDmode);
 // Initialize the LED string to 1/4 brightness, white color
-	for (int LED_ptr=0;LED_ptr<NUM_LEDS*3;LED_ptr+=3)
+	for (ledindex_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr+=LED_CHANNELS)
 	{
-		LEDarray[LED_ptr] = 0;			// Green
-		LEDarray[LED_ptr+1] = 0;		// Red
-		LEDarray[LED_ptr+2] = 0;		// Blue
+		LEDarray[LED_ptr+LED_GRN] = 0;			// Green
+		LEDarray[LED_ptr+LED_RED] = 0;		// Red
+		LEDarray[LED_ptr+LED_BLU] = 0;		// Blue
 	}
-	updateLEDs(LEDarray, NUM_LEDS*3);
+	ledFrameDone(LEDarray);
+#ifdef LED_BENCHMARK
+// Time the LED output path and the effects while nothing else is going on yet
+	ledBenchmark((uint8_t *)LEDarray);			// The array is at least LED_FRAME_BYTES bytes either way
+	effectBenchmark();
+	particleBenchmark();
+	randomBenchmark();
+	hsvBenchmark();
+	layerBenchmark();
+	noiseBenchmark();
+	programBenchmark();
+#endif
+// The PROGRAM subMode runs the last program saved, until another one comes
+	programRestore();
 	syncOn = false;
 // Initialize the state of the flag that says the network is available for transmission
 	appDataReqBusy = false;
@@ -765,45 +722,66 @@ static void APP_TaskHandler(void)
 // messages on the LED command app endpoint
 		case APP_STATE_DATARDY:
 		{
-			if (cmdBuffer->mode == MODE_GLOBAL)
+			if ((cmdBuffer->mode == MODE_GLOBAL) && (cmdBuffer->layer != 0))
 			{
-//				Set up the common parameters provided by the command message
-				currentLEDmode = cmdBuffer->subMode;
-				switch (currentLEDmode)
+//				An overlay layer takes the pattern and effect of the command, and the layers under it
+//				carry on as they were.  The period stays the base's, as all the layers step together.
+				showStop();
+				if (cmdBuffer->layer < LAYER_COUNT)
 				{
-					case RANDOM:
-					{
-						randomFreq = cmdBuffer->modeParam;
-					}	break;
-					case THROB:
-					{
-						throbDelta = cmdBuffer->modeParam;
-						throbFade = 1;
-						throbTimerAccel = 0;
-					}	break;
-					case ONESHOT:
+					LED_Command_t *running = &cmdLayer[cmdBuffer->layer - 1];
+
+//					A resend of the layer's command only keeps it alive, as for the base
+					if (cmdLayerValid[cmdBuffer->layer - 1] && (cmdBuffer->blend == running->blend)
+						&& (cmdBuffer->alpha == running->alpha) && cmdRepeated(running))
 					{
-						pulseOn = true;
-					}	break;
-					default:
+						appState = APP_STATE_IDLE;
+						break;
+					}
+					ledFrameFade(cmdBuffer->fade_mS / LED_FRAME_INTERVAL);
+					cmdPattern(layerPattern(cmdBuffer->layer));
+					layerSelect(cmdBuffer->layer, cmdBuffer->subMode, cmdBuffer->blend, cmdBuffer->alpha);
+					layerParam(cmdBuffer->layer, cmdBuffer->modeParam);
+					layersFrameDone();
+					memcpy(running, cmdBuffer, sizeof(LED_Command_t));
+					cmdLayerValid[cmdBuffer->layer - 1] = true;
+				}
+			} else if (cmdBuffer->mode == MODE_GLOBAL)
+			{
+				showStop();
+//				Set up the common parameters provided by the command message
+				animationInterval(cmdBuffer->period_mS);
+//				A resend of the running command only keeps it alive
+				if (cmdRunningValid && cmdRepeated(&cmdRunning))
+				{
+					appState = APP_STATE_IDLE;
 					break;
 				}
-				animationTimer.interval = cmdBuffer->period_mS;
-				animationTimerPeriod = cmdBuffer->period_mS;
-
-//				This mode is fixed color mode where command provides a color pattern
-				cmdBufferPtr = 0;
-				for (int LED_ptr=0;LED_ptr<NUM_LEDS*3;LED_ptr+=3)
+//				Blend from what is showing into the new effect over the frame ticks the command asks
+//				for.  The effect starts now and runs while it fades in.
+				ledFrameFade(cmdBuffer->fade_mS / LED_FRAME_INTERVAL);
+
+//				This mode is fixed color mode where command provides a color pattern, and the base
+//				effect starts from it.  Any overlay layers carry on over the new base.
+				cmdPattern(LEDpattern);
+//				The running effect takes new colors or a new modeParam without starting again if it
+//				can, so a throb or breath keeps its phase
+				if (cmdRunningValid && (cmdBuffer->subMode == cmdRunning.subMode) && effectRepattern())
+				{
+					if (cmdBuffer->modeParam != cmdRunning.modeParam)
+						effectParam(cmdBuffer->modeParam);
+				} else
 				{
-					LEDarray[LED_ptr] = cmdBuffer->grnIntensity[cmdBufferPtr];			// Green
-					LEDpattern[LED_ptr] = LEDarray[LED_ptr];
-					LEDarray[LED_ptr+1] = cmdBuffer->redIntensity[cmdBufferPtr];		// Red
-					LEDpattern[LED_ptr+1] = LEDarray[LED_ptr+1];
-					LEDarray[LED_ptr+2] = cmdBuffer->bluIntensity[cmdBufferPtr];		// Blue
-					LEDpattern[LED_ptr+2] = LEDarray[LED_ptr+2];
-					cmdBufferPtr++;
+					memcpy(LEDarray, LEDpattern, LED_FRAME_BYTES * sizeof(ledval_t));
+					layersFrameDone();
+//					Start the effect for the new subMode on the new pattern
+					currentLEDmode = cmdBuffer->subMode;
+					throbTimerAccel = 0;
+					effectSelect(currentLEDmode);
+					effectParam(cmdBuffer->modeParam);
 				}
-				updateLEDs(LEDarray, NUM_LEDS*3);
+				memcpy(&cmdRunning, cmdBuffer, sizeof(LED_Command_t));
+				cmdRunningValid = true;
 				appState = APP_STATE_IDLE;
 
 // This is for the non-centrally controlled operation.  It should be the default when the node
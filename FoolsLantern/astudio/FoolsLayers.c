@@ -0,0 +1,301 @@
+/*
+ * \file FoolsLayers.c
+ *
+ * \brief Compositor that runs effects on overlay layers over the current effect
+ *
+ *	Each overlay layer has its own line and pattern of LED_FRAME_BYTES values and its own
+ *	EffectState_t.  To step a layer, LEDarray, LEDpattern and effectState are pointed at them,
+ *	its effect's step is called just as the current effect's is, and they are pointed back.
+ *	Nothing is copied, so a layer costs its effect's step and its blend.  Each layer keeps its
+ *	own line rather than all of them drawing into one scratch line, because PARTICLES,
+ *	FIRECRACKER and others draw each step over what they drew the step before.  So the RAM for
+ *	the layers is fixed at LAYER_COUNT - 1 times two lines and the largest state, about 280
+ *	bytes a layer with 16 LEDs, plus the frame they are blended into, and nothing is allocated.
+ *
+ *	When anything has changed, the frame is built from the base line with each overlay that is
+ *	on blended over it in turn:
+ *		BLEND_ADD		The layer is added, saturating at full brightness
+ *		BLEND_MAX		The brighter of the two
+ *		BLEND_ALPHA		The layer over the frame at the opacity in alpha
+ *		BLEND_MULTIPLY	The frame scaled by the layer, so a dark layer masks it
+ *	Without LED_DITHER this is all 8-bit arithmetic on 8-bit values.  With it the values are
+ *	8.8 and the sums are wider, but they saturate the same way.
+ *
+ *	The overlays step when the base does, at its period.  ROTATE turns only the layer it runs
+ *	on: each overlay is blended from further along its line, by its own rotation less the
+ *	base's, and the output stage turns the whole frame by the base's.  A streaming base (see
+ *	LED_STREAM_LEDS) is never in an array, so no layers go over it, but a streaming effect on
+ *	an overlay draws its line from its pixel function like any other.
+ *
+ *	With LED_BENCHMARK, layerBenchmark() times copying the base into the frame and each blend
+ *	of one layer over it into layerBenchBlendCycles[].  From those and effectBenchCycles[] it
+ *	works out how many layers, the base included, fit in a 60 fps frame after the frame has been
+ *	sent if every one runs the slowest effect with the slowest blend, into layerBench60fps.
+ *	ledBenchRenderCycles has what each step really took, layers and all.
+ */
+
+#include <string.h>
+#include "config.h"
+#include "FoolsModes.h"
+#include "FoolsEffects.h"
+#include "FoolsLayers.h"
+#include "LEDBench.h"
+
+/*****************************************************************************
+ Preprocessor definitions
+*****************************************************************************/
+
+#define LAYER_BENCH_PASSES			16			// Blends of each kind timed by layerBenchmark()
+
+#ifdef LED_DITHER
+typedef uint32_t layerSum_t;					// Holds the sum or product of two values
+#else
+typedef uint16_t layerSum_t;
+#endif
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+static Layer_t layers[LAYER_COUNT - 1];				// The overlays, layers[0] is layer 1
+static ledval_t layerFrame[LED_FRAME_BYTES];		// The layers blended together
+static uint8_t layersOn = 0;						// Overlays that are not BLEND_NONE
+
+// Where the effect pointers were before a layer was stepped
+static ledval_t *layerBaseLine;
+static ledval_t *layerBasePattern;
+static EffectState_t *layerBaseState;
+
+#ifdef LED_BENCHMARK
+volatile uint32_t layerBenchBlendCycles[BLEND_MULTIPLY + 1];
+volatile uint16_t layerBench60fps;
+#endif
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+// Point the effects at a layer, and back again
+static void layerEnter(Layer_t *overlay)
+{
+	layerBaseLine = LEDarray;
+	layerBasePattern = LEDpattern;
+	layerBaseState = effectState;
+	LEDarray = overlay->line;
+	LEDpattern = overlay->pattern;
+	effectState = &overlay->state;
+}
+
+static void layerLeave(void)
+{
+	LEDarray = layerBaseLine;
+	LEDpattern = layerBasePattern;
+	effectState = layerBaseState;
+}
+
+static void layersCount(void)
+{
+	layersOn = 0;
+	for (uint8_t layer=0;layer<LAYER_COUNT-1;layer++)
+	{
+		if (layers[layer].blend != BLEND_NONE)
+			layersOn++;
+	}
+}
+
+ledval_t *layerPattern(uint8_t layer)
+{
+	return layers[layer - 1].pattern;
+}
+
+void layerSelect(uint8_t layer, uint8_t mode, uint8_t blend, uint8_t alpha)
+{
+	Layer_t *overlay = &layers[layer - 1];
+
+	overlay->mode = mode;
+	overlay->blend = (blend <= BLEND_MULTIPLY) ? blend : BLEND_NONE;
+	overlay->alpha = alpha;
+	memcpy(overlay->line, overlay->pattern, sizeof(overlay->line));
+	layerEnter(overlay);
+	effectInitMode(mode);
+	layerLeave();
+	layersCount();
+}
+
+void layerParam(uint8_t layer, uint16_t modeParam)
+{
+	Layer_t *overlay = &layers[layer - 1];
+
+	layerEnter(overlay);
+	effectParamMode(overlay->mode, modeParam);
+	layerLeave();
+}
+
+void layersClear(void)
+{
+	for (uint8_t layer=0;layer<LAYER_COUNT-1;layer++)
+	{
+		layers[layer].blend = BLEND_NONE;
+	}
+	layersOn = 0;
+}
+
+bool layersStep(void)
+{
+	Layer_t *overlay;
+	bool changed = false;
+
+	if (layersOn == 0)
+		return false;
+	for (overlay=layers;overlay<&layers[LAYER_COUNT-1];overlay++)
+	{
+		if (overlay->blend == BLEND_NONE)
+			continue;
+		layerEnter(overlay);
+		if (effectStepMode(overlay->mode))
+			changed = true;
+		layerLeave();
+	}
+	return changed;
+}
+
+/*****************************************************************************
+	Blend count values of a layer's line over the frame
+*****************************************************************************/
+static void layerBlendRun(const Layer_t *overlay, ledval_t *frame, const ledval_t *line, ledindex_t count)
+{
+	layerSum_t value;
+	uint16_t weight;
+
+	switch (overlay->blend)
+	{
+		case BLEND_ADD:
+		{
+			for (ledindex_t LED_ptr=0;LED_ptr<count;LED_ptr++)
+			{
+				value = (layerSum_t)*frame + *line++;
+				*frame++ = (value > LED_VALUE_MAX) ? LED_VALUE_MAX : value;
+			}
+		} break;
+		case BLEND_MAX:
+		{
+			for (ledindex_t LED_ptr=0;LED_ptr<count;LED_ptr++)
+			{
+				if (*line > *frame)
+					*frame = *line;
+				line++;
+				frame++;
+			}
+		} break;
+		case BLEND_ALPHA:
+		{
+// 0 to 256, so that 255 shows the layer alone
+			weight = overlay->alpha + (overlay->alpha >> 7);
+			for (ledindex_t LED_ptr=0;LED_ptr<count;LED_ptr++)
+			{
+				*frame = ((layerSum_t)*frame * (256 - weight) + (layerSum_t)*line++ * weight) >> 8;
+				frame++;
+			}
+		} break;
+		case BLEND_MULTIPLY:
+		{
+			for (ledindex_t LED_ptr=0;LED_ptr<count;LED_ptr++)
+			{
+				*frame = ((layerSum_t)*frame * ((*line++ >> LED_FRAC_BITS) + 1)) >> 8;
+				frame++;
+			}
+		} break;
+		default:
+		break;
+	}
+}
+
+/*****************************************************************************
+	Blend one layer over the frame, from the LED of its line that goes over the start of the
+	frame to the end of the line and then from its start.  ROTATE on the overlay moves that LED
+	along, and ROTATE on the base moves it back again, as the output stage turns the whole frame
+	by the base's rotation when it is sent.  So each layer only turns with its own ROTATE.
+*****************************************************************************/
+static void layerBlend(const Layer_t *overlay)
+{
+	int16_t led = -(int16_t)ledFrameHead();
+	ledindex_t head;
+
+	if (overlay->mode == ROTATE)
+		led += overlay->state.rotate.head;
+	if (led < 0)
+		led += NUM_LEDS;
+	head = led * LED_CHANNELS;
+	layerBlendRun(overlay, layerFrame, &overlay->line[head], LED_FRAME_BYTES - head);
+	if (head != 0)
+		layerBlendRun(overlay, &layerFrame[LED_FRAME_BYTES - head], overlay->line, head);
+}
+
+void layersFrameDone(void)
+{
+	if (layersOn == 0)
+	{
+		ledFrameDone(LEDarray);
+		return;
+	}
+	memcpy(layerFrame, LEDarray, sizeof(layerFrame));
+	for (uint8_t layer=0;layer<LAYER_COUNT-1;layer++)
+	{
+		layerBlend(&layers[layer]);
+	}
+	ledFrameDone(layerFrame);
+}
+
+#ifdef LED_BENCHMARK
+/*****************************************************************************
+	Time LAYER_BENCH_PASSES copies of the base and blends of layer 1 of each kind over it,
+	and divide what is left of a 60 fps frame, after sending it and copying the base, among
+	layers of the slowest effect from effectBenchCycles[] with the slowest blend.  So this has
+	to run after effectBenchmark(), and after a frame has been sent.  The base line and the
+	layer are cleared again at the end.
+*****************************************************************************/
+void layerBenchmark(void)
+{
+	Layer_t *overlay = &layers[0];
+	uint32_t start;
+	uint32_t blend = 0;
+	uint32_t effect = 0;
+	uint32_t budget;
+
+	benchInit();
+	for (ledindex_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr++)
+	{
+		LEDarray[LED_ptr] = LED_VALUE((LED_ptr * 37) & 0xFF);
+		overlay->line[LED_ptr] = LED_VALUE((LED_ptr * 91) & 0xFF);
+	}
+	overlay->alpha = 128;
+	start = benchTicks();
+	for (uint8_t pass=0;pass<LAYER_BENCH_PASSES;pass++)
+		memcpy(layerFrame, LEDarray, sizeof(layerFrame));
+	layerBenchBlendCycles[BLEND_NONE] = BENCH_TICKS_TO_CYCLES(benchTicks() - start) / LAYER_BENCH_PASSES;
+	for (uint8_t mode=BLEND_ADD;mode<=BLEND_MULTIPLY;mode++)
+	{
+		overlay->blend = mode;
+		start = benchTicks();
+		for (uint8_t pass=0;pass<LAYER_BENCH_PASSES;pass++)
+			layerBlend(overlay);
+		layerBenchBlendCycles[mode] = BENCH_TICKS_TO_CYCLES(benchTicks() - start) / LAYER_BENCH_PASSES;
+		if (layerBenchBlendCycles[mode] > blend)
+			blend = layerBenchBlendCycles[mode];
+	}
+	for (uint8_t mode=0;mode<effectCount;mode++)
+	{
+		if (effectBenchCycles[mode] > effect)
+			effect = effectBenchCycles[mode];
+	}
+	budget = F_CPU / 60;
+	if (budget > ledBenchOutputCycles + layerBenchBlendCycles[BLEND_NONE])
+		budget -= ledBenchOutputCycles + layerBenchBlendCycles[BLEND_NONE];
+	else
+		budget = 0;
+	layerBench60fps = budget / (effect + blend);
+	memset(LEDarray, 0, LED_FRAME_BYTES * sizeof(ledval_t));
+	memset(overlay->line, 0, sizeof(overlay->line));
+	layersClear();
+}
+#endif // LED_BENCHMARK
@@ -0,0 +1,55 @@
+/*
+	Overlay layers over the current effect.  The effect started by effectSelect() is the base,
+	layer 0, and layers 1 to LAYER_COUNT - 1 each run another effect with its own pattern,
+	modeParam and state, blended over the layers under them.  A layer is started by a command
+	with its number in LED_Command_t layer, and taken off again with BLEND_NONE.
+*/
+#ifndef _FOOLS_LAYERS_H_
+#define _FOOLS_LAYERS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FoolsEffects.h"
+
+#if (LAYER_COUNT < 2) || (LAYER_COUNT > 4)
+#error "FoolsLayers.h: LAYER_COUNT should be 2 to 4"
+#endif
+
+typedef struct Layer_t {
+	uint8_t		mode;							// subMode of the effect on the layer
+	uint8_t		blend;							// BLEND_NONE while the layer is off
+	uint8_t		alpha;							// Opacity for BLEND_ALPHA, 255 is opaque
+	EffectState_t	state;
+	ledval_t	line[LED_FRAME_BYTES];			// The layer's LEDarray
+	ledval_t	pattern[LED_FRAME_BYTES];		// and its LEDpattern
+} Layer_t;
+
+// Pattern of an overlay layer, 1 to LAYER_COUNT - 1, to fill before layerSelect()
+extern ledval_t *layerPattern (uint8_t layer);
+
+// Starts an effect on an overlay layer from its pattern, or takes the layer off with BLEND_NONE
+extern void layerSelect (uint8_t layer, uint8_t mode, uint8_t blend, uint8_t alpha);
+
+// Passes a command's modeParam to the effect on an overlay layer
+extern void layerParam (uint8_t layer, uint16_t modeParam);
+
+// Takes all the overlay layers off
+extern void layersClear (void);
+
+// Draws the next step of every overlay layer that is on.  True if any of them changed.
+extern bool layersStep (void);
+
+// Blends the layers that are on over the base into one frame and hands it to ledFrameDone()
+extern void layersFrameDone (void);
+
+#ifdef LED_BENCHMARK
+// Cycles to copy the base into the frame, by [BLEND_NONE], and to blend one layer over it, by the
+// other blends, and how many layers of the slowest effect and blend fit in a 60 fps frame after
+// sending it.  See FoolsLayers.c.
+extern volatile uint32_t layerBenchBlendCycles[];
+extern volatile uint16_t layerBench60fps;
+
+extern void layerBenchmark (void);
+#endif
+
+#endif // _FOOLS_LAYERS_H_
@@ -0,0 +1,174 @@
+/*
+ * \file FoolsNoise.c
+ *
+ * \brief Gradient noise in 8-bit fixed point
+ *
+ *	Perlin's gradient noise, cut down for the AVR.  Each lattice point gets a pseudo-random
+ *	gradient from a hash of its coordinates, which is a read of noisePerm[] in flash for each
+ *	dimension.  The value at a point between them is the gradients at the corners of its cell
+ *	dotted with the offsets from those corners, blended across the cell with the 3t^2 - 2t^3
+ *	ease curve, so it is smooth through the lattice points too.  The gradients are only ever
+ *	+1 or -1 on each axis, so the dot products are additions, and the offsets are 7 bits so
+ *	that a difference times a 7-bit weight fits in 16 bits.  A sample of noise1() is two table
+ *	reads and one blend, and of noise2() six table reads and three blends.
+ *
+ *	With LED_BENCHMARK, noiseBenchmark() times NOISE_BENCH_SAMPLES samples of each into
+ *	noiseBench1Cycles and noiseBench2Cycles.  What the effects made from them cost per LED, and
+ *	how many LEDs each can draw at 30 fps, is in effectBenchPixelCycles[] and effectBench30fps[].
+ *
+ *	These have not been measured yet.  The figures below are rough estimates made by hand from
+ *	the C, by counting the table reads, multiplies and additions, at 16 MHz for an LED within
+ *	NUM_LEDS.  The most LEDs at 30 fps also count the 480 cycles per LED the bit-banged driver
+ *	takes to send it (see LEDBench.c), out of 533333 cycles a frame:
+ *		noise1()		 100 cycles
+ *		noise2()		 270 cycles
+ *		FIRE			 390 cycles per LED		610 LEDs at 30 fps
+ *		PLASMA			 430 cycles per LED		590 LEDs at 30 fps
+ *		WATER			 670 cycles per LED		460 LEDs at 30 fps
+ *	They could easily be out by a third either way, and the benchmarks above replace them.  Past
+ *	NUM_LEDS, patternOffset() adds a 16-bit modulo of about 200 cycles.  A streamed LED has to
+ *	be drawn in the 560 or so cycles LEDStream.c has between LEDs, which by these figures
+ *	WATER does not fit, so watch ledStreamDropped before streaming it.
+ */
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "config.h"
+#include "FoolsNoise.h"
+#ifdef LED_BENCHMARK
+#include "LEDBench.h"
+#endif
+
+/*****************************************************************************
+ Preprocessor definitions
+*****************************************************************************/
+
+// Spreads the raw noise, at most about a quarter of full scale either way of 0, over 0 to 255.
+// The few samples past the ends are clamped.
+#define NOISE_GAIN					2
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+// Perlin's reference permutation of 0 to 255, the hash of the lattice coordinates
+static const uint8_t noisePerm[256] PROGMEM =
+{
+	151, 160, 137,  91,  90,  15, 131,  13, 201,  95,  96,  53, 194, 233,   7, 225,
+	140,  36, 103,  30,  69, 142,   8,  99,  37, 240,  21,  10,  23, 190,   6, 148,
+	247, 120, 234,  75,   0,  26, 197,  62,  94, 252, 219, 203, 117,  35,  11,  32,
+	 57, 177,  33,  88, 237, 149,  56,  87, 174,  20, 125, 136, 171, 168,  68, 175,
+	 74, 165,  71, 134, 139,  48,  27, 166,  77, 146, 158, 231,  83, 111, 229, 122,
+	 60, 211, 133, 230, 220, 105,  92,  41,  55,  46, 245,  40, 244, 102, 143,  54,
+	 65,  25,  63, 161,   1, 216,  80,  73, 209,  76, 132, 187, 208,  89,  18, 169,
+	200, 196, 135, 130, 116, 188, 159,  86, 164, 100, 109, 198, 173, 186,   3,  64,
+	 52, 217, 226, 250, 124, 123,   5, 202,  38, 147, 118, 126, 255,  82,  85, 212,
+	207, 206,  59, 227,  47,  16,  58,  17, 182, 189,  28,  42, 223, 183, 170, 213,
+	119, 248, 152,   2,  44, 154, 163,  70, 221, 153, 101, 155, 167,  43, 172,   9,
+	129,  22,  39, 253,  19,  98, 108, 110,  79, 113, 224, 232, 178, 185, 112, 104,
+	218, 246,  97, 228, 251,  34, 242, 193, 238, 210, 144,  12, 191, 179, 162, 241,
+	 81,  51, 145, 235, 249,  14, 239, 107,  49, 192, 214,  31, 181, 199, 106, 157,
+	184,  84, 204, 176, 115, 121,  50,  45, 127,   4, 150, 254, 138, 236, 205,  93,
+	222, 114,  67,  29,  24,  72, 243, 141, 128, 195,  78,  66, 215,  61, 156, 180
+};
+
+#ifdef LED_BENCHMARK
+volatile uint16_t noiseBench1Cycles;
+volatile uint16_t noiseBench2Cycles;
+#endif
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+static inline uint8_t noiseHash(uint8_t i)
+{
+	return pgm_read_byte(&noisePerm[i]);
+}
+
+// 3t^2 - 2t^3 of the position in the cell, 0 to 128
+static inline uint8_t noiseEase(uint8_t t)
+{
+	uint8_t t2 = ((uint16_t)t * t) >> 8;
+	uint8_t t3 = ((uint16_t)t2 * t) >> 8;
+
+	return (3 * t2 - 2 * t3) >> 1;
+}
+
+// From a to b by weight out of 128
+static inline int16_t noiseLerp(int16_t a, int16_t b, uint8_t weight)
+{
+	return a + (((b - a) * (int16_t)weight) >> 7);
+}
+
+// Offset from a corner, dotted with its gradient
+static inline int16_t noiseGrad1(uint8_t hash, int8_t dx)
+{
+	return (hash & 1) ? -dx : dx;
+}
+
+static inline int16_t noiseGrad2(uint8_t hash, int8_t dx, int8_t dy)
+{
+	int16_t u = (hash & 1) ? -dx : dx;
+	int16_t v = (hash & 2) ? -dy : dy;
+
+	return (u + v) >> 1;
+}
+
+static inline uint8_t noiseOut(int16_t n)
+{
+	n += 128;
+	if (n < 0)
+		return 0;
+	return (n > 255) ? 255 : n;
+}
+
+uint8_t noise1(uint16_t x)
+{
+	uint8_t xi = x >> 8;
+	int8_t dx = (x & 0xFF) >> 1;
+	int16_t n;
+
+	n = noiseLerp(noiseGrad1(noiseHash(xi), dx), noiseGrad1(noiseHash(xi + 1), dx - 128), noiseEase(x & 0xFF));
+	return noiseOut(n * NOISE_GAIN);
+}
+
+uint8_t noise2(uint16_t x, uint16_t y)
+{
+	uint8_t xi = x >> 8;
+	uint8_t yi = y >> 8;
+	int8_t dx = (x & 0xFF) >> 1;
+	int8_t dy = (y & 0xFF) >> 1;
+	uint8_t h0 = noiseHash(xi);
+	uint8_t h1 = noiseHash(xi + 1);
+	uint8_t wx = noiseEase(x & 0xFF);
+	int16_t n0;
+	int16_t n1;
+
+	n0 = noiseLerp(noiseGrad2(noiseHash(h0 + yi), dx, dy), noiseGrad2(noiseHash(h1 + yi), dx - 128, dy), wx);
+	n1 = noiseLerp(noiseGrad2(noiseHash(h0 + yi + 1), dx, dy - 128), noiseGrad2(noiseHash(h1 + yi + 1), dx - 128, dy - 128), wx);
+	return noiseOut(noiseLerp(n0, n1, noiseEase(y & 0xFF)) * NOISE_GAIN);
+}
+
+#ifdef LED_BENCHMARK
+/*****************************************************************************
+	Time NOISE_BENCH_SAMPLES samples of each, along a line that crosses several cells.  The
+	samples go into a volatile so that they are not optimised away.
+*****************************************************************************/
+void noiseBenchmark(void)
+{
+	volatile uint8_t sink;
+	uint32_t start;
+
+	benchInit();
+	start = benchTicks();
+	for (uint8_t count=0;count<NOISE_BENCH_SAMPLES;count++)
+		sink = noise1(count * 77);
+	noiseBench1Cycles = BENCH_TICKS_TO_CYCLES(benchTicks() - start) / NOISE_BENCH_SAMPLES;
+	start = benchTicks();
+	for (uint8_t count=0;count<NOISE_BENCH_SAMPLES;count++)
+		sink = noise2(count * 77, count * 29);
+	noiseBench2Cycles = BENCH_TICKS_TO_CYCLES(benchTicks() - start) / NOISE_BENCH_SAMPLES;
+	(void)sink;
+}
+#endif // LED_BENCHMARK
@@ -0,0 +1,29 @@
+/*
+	Coherent noise for the effects that want something organic rather than regular: 8-bit
+	gradient noise in one and two dimensions, in fixed point with no floats, see FoolsNoise.c.
+	The coordinates are 8.8 fixed point, one lattice cell to every 256, and the noise repeats
+	every 256 cells, so a coordinate can be left to wrap around with no seam.
+*/
+#ifndef _FOOLS_NOISE_H_
+#define _FOOLS_NOISE_H_
+
+#include <stdint.h>
+
+// Noise along a line, 0 to 255 around a middle of 128
+extern uint8_t noise1 (uint16_t x);
+
+// Noise over a plane, 0 to 255 around a middle of 128.  One coordinate is usually a position
+// along the strip and the other time, so that the pattern churns as well as moving.
+extern uint8_t noise2 (uint16_t x, uint16_t y);
+
+#ifdef LED_BENCHMARK
+#define NOISE_BENCH_SAMPLES		64				// Samples of each timed by noiseBenchmark()
+
+// CPU cycles per sample of noise1() and noise2(), see FoolsNoise.c
+extern volatile uint16_t noiseBench1Cycles;
+extern volatile uint16_t noiseBench2Cycles;
+
+extern void noiseBenchmark (void);
+#endif
+
+#endif // _FOOLS_NOISE_H_
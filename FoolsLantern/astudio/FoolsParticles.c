@@ -0,0 +1,249 @@
+/*
+ * \file FoolsParticles.c
+ *
+ * \brief Particle effect: sparks, comets and bursts drawn from a fixed pool
+ *
+ *	Each step the whole strip is dimmed, which leaves the trails, then at most one spawn
+ *	happens and every live particle moves, fades and is added into LEDarray.  A particle
+ *	between two LEDs is split across both of them by the fraction of its position, so slow
+ *	particles glide instead of jumping from LED to LED.  Adding saturates at full brightness,
+ *	so particles that cross get brighter where they overlap.  A particle is dropped when its
+ *	life runs out or it leaves the strip, and its slot is free for the next spawn.
+ *
+ *	The color of a new particle comes from the pattern of the command at the LED it starts
+ *	on, or white where the pattern is dark, so the controller colors the particles the same
+ *	way it colors the other modes.  modeParam carries the style in its low byte and the spawn
+ *	rate in its high byte:
+ *		PARTICLE_SPARKS		Short flashes anywhere on the strip, drifting a little
+ *		PARTICLE_COMETS		Particles running the length of the strip with a long tail
+ *		PARTICLE_BURSTS		Up to PARTICLE_BURST_SIZE particles flying apart from one LED
+ *
+ *	With LED_BENCHMARK, particleBenchmark() times a step with an empty pool and one with every
+ *	slot drawing two LEDs, and works out how many particles fit in a 60 fps frame once the
+ *	frame has been sent.  On a 16 MHz ATmega128RFA1 with 16 LEDs on the bit-banged driver the
+ *	output takes about 8000 cycles of the 266666 in a frame, and a particle a few hundred,
+ *	so the limit is RAM (11 bytes a particle) long before it is time.
+ */
+
+#include <string.h>
+#include "config.h"
+#include "FoolsModes.h"
+#include "FoolsEffects.h"
+#include "LEDBench.h"
+
+/*****************************************************************************
+ Preprocessor definitions
+*****************************************************************************/
+
+#define PARTICLE_RATE				64			// Spawn chance out of 256 each step, unless modeParam sets it
+#define PARTICLE_BURST_SIZE			8			// Most particles started by one burst
+#define PARTICLE_LIFE				0xFF00		// Full brightness, 8.8
+#define PARTICLE_END				((particlePos_t)NUM_LEDS << 8)	// First position off the end of the strip
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+#ifdef LED_BENCHMARK
+volatile uint32_t particleBenchEmptyCycles;
+volatile uint32_t particleBenchCycles;
+volatile uint16_t particleBench60fps;
+#endif
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+void particlesInit(void)
+{
+	effectState->particles.style = PARTICLE_SPARKS;
+	effectState->particles.rate = PARTICLE_RATE;
+	randomStream(&effectState->particles.stream);
+}
+
+void particlesParam(uint16_t modeParam)
+{
+	effectState->particles.style = modeParam & 0xFF;
+	if (effectState->particles.style > PARTICLE_BURSTS)
+		effectState->particles.style = PARTICLE_SPARKS;
+	effectState->particles.rate = modeParam >> 8;
+	if (effectState->particles.rate == 0)
+		effectState->particles.rate = PARTICLE_RATE;
+}
+
+/*****************************************************************************
+	Start a particle in a free slot, if there is one, at the given LED.  Returns false when
+	the pool is full.
+*****************************************************************************/
+static bool particleSpawn(uint16_t LED, int16_t vel, uint16_t fade)
+{
+	Particle_t *particle = effectState->particles.pool;
+	ledindex_t LED_ptr = LED * LED_CHANNELS;
+
+	while (particle->life != 0)
+	{
+		if (++particle == &effectState->particles.pool[PARTICLE_POOL_SIZE])
+			return false;
+	}
+	particle->pos = ((particlePos_t)LED << 8) + 0x80;
+	particle->vel = vel;
+	particle->life = PARTICLE_LIFE;
+	particle->fade = fade;
+	particle->red = LEDpattern[LED_ptr+LED_RED] >> LED_FRAC_BITS;
+	particle->grn = LEDpattern[LED_ptr+LED_GRN] >> LED_FRAC_BITS;
+	particle->blu = LEDpattern[LED_ptr+LED_BLU] >> LED_FRAC_BITS;
+	if ((particle->red | particle->grn | particle->blu) == 0)
+	{
+		particle->red = 255;
+		particle->grn = 255;
+		particle->blu = 255;
+	}
+	return true;
+}
+
+/*****************************************************************************
+	Add a color at a brightness (0-255) into one LED, saturating at full
+*****************************************************************************/
+static void particleAdd(ledval_t *LED, uint8_t color, uint8_t bright)
+{
+	ledval_t add = ((uint16_t)color * bright) >> (8 - LED_FRAC_BITS);
+
+	if (add > LED_VALUE_MAX - *LED)
+		*LED = LED_VALUE_MAX;
+	else
+		*LED += add;
+}
+
+static void particleDraw(const Particle_t *particle)
+{
+	ledindex_t LED_ptr = (particle->pos >> 8) * LED_CHANNELS;
+	uint8_t bright = particle->life >> 8;
+	uint8_t next = ((uint16_t)bright * (particle->pos & 0xFF)) >> 8;
+
+// The share of the brightness that goes to the next LED is the fraction of the position
+	bright -= next;
+	particleAdd(&LEDarray[LED_ptr+LED_RED], particle->red, bright);
+	particleAdd(&LEDarray[LED_ptr+LED_GRN], particle->grn, bright);
+	particleAdd(&LEDarray[LED_ptr+LED_BLU], particle->blu, bright);
+	LED_ptr += LED_CHANNELS;
+	if ((next != 0) && (LED_ptr < LED_FRAME_BYTES))
+	{
+		particleAdd(&LEDarray[LED_ptr+LED_RED], particle->red, next);
+		particleAdd(&LEDarray[LED_ptr+LED_GRN], particle->grn, next);
+		particleAdd(&LEDarray[LED_ptr+LED_BLU], particle->blu, next);
+	}
+}
+
+bool particlesStep(void)
+{
+	uint8_t style = effectState->particles.style;
+	uint8_t decay = (style == PARTICLE_COMETS) ? 2 : 1;
+	uint16_t random;
+	uint16_t LED;
+	Particle_t *particle;
+	ledval_t *line = LEDarray;
+
+// Sparks and bursts go out quickly, comets leave a tail
+	for (ledindex_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr++)
+	{
+		*line -= *line >> decay;
+		line++;
+	}
+	if (random8(&effectState->particles.stream) < effectState->particles.rate)
+	{
+		random = random16(&effectState->particles.stream);
+		LED = randomRange(&effectState->particles.stream, NUM_LEDS);
+		switch (style)
+		{
+			case PARTICLE_COMETS:
+			{
+// From one end or the other, a quarter to three quarters of an LED a step
+				if (random & 0x8000)
+					particleSpawn(0, 0x40 + (random & 0x7F), 0x0100);
+				else
+					particleSpawn(NUM_LEDS-1, -(0x40 + (random & 0x7F)), 0x0100);
+			} break;
+			case PARTICLE_BURSTS:
+			{
+				for (uint8_t count=0;count<PARTICLE_BURST_SIZE;count++)
+				{
+					if (!particleSpawn(LED, (int8_t)random16(&effectState->particles.stream), 0x0C00))
+						break;
+				}
+			} break;
+			default:
+			{
+// A slow drift either way and gone in 8 to 16 steps
+				particleSpawn(LED, (int8_t)random >> 3, 0x1000 + (random & 0x0F00));
+			} break;
+		}
+	}
+	for (particle=effectState->particles.pool;particle<&effectState->particles.pool[PARTICLE_POOL_SIZE];particle++)
+	{
+		if (particle->life == 0)
+			continue;
+		particle->life = (particle->life > particle->fade) ? particle->life - particle->fade : 0;
+		particle->pos += particle->vel;
+		if ((particle->pos < 0) || (particle->pos >= PARTICLE_END))
+			particle->life = 0;
+		if (particle->life != 0)
+			particleDraw(particle);
+	}
+	return true;
+}
+
+#ifdef LED_BENCHMARK
+/*****************************************************************************
+	Time EFFECT_BENCH_STEPS steps with the pool empty and again with it full, each particle
+	halfway between two LEDs so that it draws both, and none of them moving or fading.  The
+	difference is the cost of the particles.  Then one frame is sent the way the frame timer
+	sends it, and what is left of a 60 fps frame after that is divided among the particles.
+	The strip is cleared again at the end.
+*****************************************************************************/
+void particleBenchmark(void)
+{
+	Particle_t *particle;
+	uint32_t start;
+	uint32_t empty;
+	uint32_t full;
+	uint32_t budget;
+
+	benchInit();
+	memset(LEDarray, 0, LED_FRAME_BYTES * sizeof(ledval_t));
+	effectSelect(PARTICLES);
+	effectState->particles.rate = 0;				// Nothing spawns, the pool is filled here
+	start = benchTicks();
+	for (uint8_t step=0;step<EFFECT_BENCH_STEPS;step++)
+		particlesStep();
+	empty = BENCH_TICKS_TO_CYCLES(benchTicks() - start) / EFFECT_BENCH_STEPS;
+	for (uint8_t count=0;count<PARTICLE_POOL_SIZE;count++)
+	{
+		particle = &effectState->particles.pool[count];
+		particle->pos = ((particlePos_t)(count % (NUM_LEDS - 1)) << 8) + 0x80;
+		particle->vel = 0;
+		particle->life = PARTICLE_LIFE;
+		particle->fade = 0;
+		particle->red = 0x10;					// Dim, like ledBenchmark(), the sums cost the same
+		particle->grn = 0x10;
+		particle->blu = 0x10;
+	}
+	start = benchTicks();
+	for (uint8_t step=0;step<EFFECT_BENCH_STEPS;step++)
+		particlesStep();
+	full = BENCH_TICKS_TO_CYCLES(benchTicks() - start) / EFFECT_BENCH_STEPS;
+	ledFrameDone(LEDarray);
+	ledFrameTick();								// Leaves its time in ledBenchOutputCycles
+	particleBenchEmptyCycles = empty;
+	particleBenchCycles = (full - empty) / PARTICLE_POOL_SIZE;
+	budget = F_CPU / 60;
+	if (budget > empty + ledBenchOutputCycles)
+		budget -= empty + ledBenchOutputCycles;
+	else
+		budget = 0;
+	particleBench60fps = (particleBenchCycles != 0) ? budget / particleBenchCycles : 0;
+	memset(LEDarray, 0, LED_FRAME_BYTES * sizeof(ledval_t));
+	ledFrameDone(LEDarray);
+	ledFrameTick();
+	effectSelect(STATIC);
+}
+#endif // LED_BENCHMARK
@@ -0,0 +1,53 @@
+/*
+	Particle effect for the PARTICLES subMode.  A fixed pool of PARTICLE_POOL_SIZE particles
+	lives in effectState, so it shares its RAM with the other effects and nothing is allocated.
+	Position, velocity and life are 8.8 fixed point, position and velocity in LEDs and LEDs per
+	step.  The whole part of life is the brightness the particle's color is drawn at.  The
+	modeParam of the command picks the style and the spawn rate, see FoolsModes.h.
+*/
+#ifndef _FOOLS_PARTICLES_H_
+#define _FOOLS_PARTICLES_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FoolsRandom.h"
+
+// 8.8 positions of a strip of more than 127 LEDs do not fit in 16 bits
+#if NUM_LEDS < 128
+typedef int16_t particlePos_t;
+#else
+typedef int32_t particlePos_t;
+#endif
+
+typedef struct Particle_t {
+	particlePos_t	pos;						// 8.8 LEDs from the start of the strip
+	int16_t			vel;						// 8.8 LEDs per step, negative runs backwards
+	uint16_t		life;						// 8.8 brightness, 0 if this slot is free
+	uint16_t		fade;						// Taken off life each step
+	uint8_t			red;
+	uint8_t			grn;
+	uint8_t			blu;
+} Particle_t;
+
+typedef struct ParticleState_t {
+	Particle_t	pool[PARTICLE_POOL_SIZE];
+	uint8_t		style;							// PARTICLE_SPARKS, PARTICLE_COMETS or PARTICLE_BURSTS
+	uint8_t		rate;							// Out of 256, the chance of spawning each step
+	RandomStream_t	stream;
+} ParticleState_t;
+
+extern void particlesInit (void);
+extern bool particlesStep (void);
+extern void particlesParam (uint16_t modeParam);
+
+#ifdef LED_BENCHMARK
+// Cost of a step with no particles, the extra cost of each live particle, and how many
+// particles could be drawn at 60 frames per second after sending the frame.  See FoolsParticles.c.
+extern volatile uint32_t particleBenchEmptyCycles;
+extern volatile uint32_t particleBenchCycles;
+extern volatile uint16_t particleBench60fps;
+
+extern void particleBenchmark (void);
+#endif
+
+#endif // _FOOLS_PARTICLES_H_
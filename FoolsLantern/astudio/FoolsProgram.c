@@ -0,0 +1,469 @@
+/*
+ * \file FoolsProgram.c
+ *
+ * \brief Loader and interpreter for effect programs sent over the radio
+ *
+ *	A program runs on a stack machine of 16-bit values, with one byte instructions and at most
+ *	two bytes of operand after them (see FoolsProgram.h).  It is sandboxed so that whatever
+ *	arrives over the radio cannot hurt the lantern:
+ *		The stack is PROGRAM_STACK values, indexed by the stack pointer masked to its size, so
+ *		pushing too much or popping too much gives wrong values but never touches other RAM.
+ *		Registers are indexed the same way.
+ *		The program counter is one byte and is checked against the length of the program before
+ *		each instruction, so a jump anywhere just ends the run.  The code buffer is two bytes
+ *		longer than PROGRAM_SIZE and the bytes past the program are 0, so the operands of an
+ *		instruction at the end read 0.
+ *		Each run of the frame or pixel code may take PROGRAM_MAX_STEPS instructions, so a program
+ *		can loop with a backward jump but cannot hang the lantern.  A run that is stopped, or that
+ *		hits an instruction that is not in the list, counts in programFaults.
+ *		The pixel code cannot change the registers or draw random numbers, so it gives the
+ *		same color for an LED however many times it is run in a step.  A STORE or RAND in it
+ *		is a fault.
+ *	The top of the stack is kept in a local, so most instructions only touch the stack array once.
+ *	The dispatch is a switch, which avr-gcc makes into a jump table.
+ *
+ *	The chunks are put together in programIncoming, and only copied over the running program when
+ *	all of it has come and the checksum is right, so a program never runs half loaded.  A program
+ *	sent with save set is written to EEPROM by programSaveTick(), one byte each frame tick with
+ *	the EEPROM writing it while the CPU gets on with other things, rather than holding up the
+ *	LEDs for the half second or so a whole program takes.  The valid mark is cleared first and
+ *	written last, so a program that was only part saved when the power went is not restored.
+ *
+ *	With LED_BENCHMARK, programBenchmark() times PROGRAM_BENCH_PIXELS LEDs of a program that
+ *	draws the same as rainbowPixel() into programBenchCycles, with the instructions each took in
+ *	programBenchInstructions.  Set against effectBenchPixelCycles[RAINBOW] that is the cost of an
+ *	interpreted effect against a native one.  The instructions per second, and the most LEDs the
+ *	program could draw and send at 30 fps in CPU time, are worked out from them.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include "config.h"
+#include "FoolsModes.h"
+#include "FoolsProgram.h"
+#include "FoolsColor.h"
+#include "FoolsEnvelopes.h"
+#include "FoolsNoise.h"
+#include "LEDBench.h"
+
+/*****************************************************************************
+ Preprocessor definitions
+*****************************************************************************/
+
+#if PROGRAM_SIZE > 253
+#error "FoolsProgram.c: PROGRAM_SIZE should be at most 253, the program counter is 8 bits"
+#endif
+
+#define PROGRAM_STACK_MASK			(PROGRAM_STACK - 1)
+#define PROGRAM_REGISTER_MASK		(PROGRAM_REGISTERS - 1)
+
+#define PROGRAM_MAGIC				0xA5		// In EEPROM when a whole program has been saved there
+#define PROGRAM_SAVE_IDLE			0xFFFF		// programSaveStep when nothing is being saved
+
+// Push a value over the top of the stack, and pop the value under the top
+#define PUSH(v)						do { stack[sp++ & PROGRAM_STACK_MASK] = tos; tos = (v); } while (0)
+#define NEXT						(stack[--sp & PROGRAM_STACK_MASK])
+
+typedef struct ProgramImage_t {
+	uint8_t		id;
+	uint8_t		length;							// 0 when there is no program
+	uint8_t		pixelEntry;
+	uint16_t	checksum;
+	uint8_t		code[PROGRAM_SIZE + 2];
+} ProgramImage_t;
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+static ProgramImage_t programCode;				// The program the PROGRAM effect runs
+static ProgramImage_t programIncoming;			// The program being received
+static uint8_t programReceived = 0;				// Bytes of it so far, 0 when none is coming
+static uint16_t programSaveStep = PROGRAM_SAVE_IDLE;
+
+static uint8_t programSavedMagic EEMEM;
+static ProgramImage_t programSaved EEMEM;
+
+volatile uint16_t programFaults;
+
+#ifdef LED_BENCHMARK
+volatile uint16_t programBenchCycles;
+volatile uint8_t programBenchInstructions;
+volatile uint32_t programBenchIPS;
+volatile uint16_t programBench30fps;
+
+// hue = 2 * time + 16 * LED, full saturation, value the brightest channel of the pattern
+static const uint8_t programBenchCode[] PROGMEM =
+{
+	PROG_END,
+	PROG_TIME, PROG_PUSH, 2, PROG_MUL, PROG_LED, PROG_PUSH, 16, PROG_MUL, PROG_ADD,
+	PROG_PUSH, 255,
+	PROG_PATR, PROG_PATG, PROG_MAX, PROG_PATB, PROG_MAX,
+	PROG_HSV,
+	PROG_END
+};
+#endif
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+static uint8_t programClamp(int16_t value)
+{
+	if (value < 0)
+		return 0;
+	return (value > 255) ? 255 : value;
+}
+
+/*****************************************************************************
+	Run the code of a program from pc until it ends, with led and pattern as its inputs and
+	pixel for the color, or NULL for the frame code.  Returns the instructions it ran.
+*****************************************************************************/
+static uint8_t programExecute(const ProgramImage_t *image, uint8_t pc, ProgramState_t *state, uint16_t led, const ledval_t pattern[], uint8_t pixel[])
+{
+	const uint8_t *code = image->code;
+	int16_t stack[PROGRAM_STACK];
+	int16_t tos = 0;
+	int16_t value;
+	uint8_t sp = 0;
+	uint8_t steps = 0;
+	RgbColor_t rgb;
+
+	while (pc < image->length)
+	{
+		if (steps == PROGRAM_MAX_STEPS)
+		{
+			programFaults++;
+			break;
+		}
+		steps++;
+		switch (code[pc++])
+		{
+			case PROG_END:
+				return steps;
+			case PROG_PUSH:
+				PUSH(code[pc++]);
+				break;
+			case PROG_PUSHW:
+				PUSH(code[pc] | (code[pc + 1] << 8));
+				pc += 2;
+				break;
+			case PROG_LOAD:
+				PUSH(state->reg[code[pc++] & PROGRAM_REGISTER_MASK]);
+				break;
+			case PROG_STORE:
+				if (pixel != NULL)
+				{
+					programFaults++;
+					return steps;
+				}
+				state->reg[code[pc++] & PROGRAM_REGISTER_MASK] = tos;
+				tos = NEXT;
+				break;
+			case PROG_DUP:
+				PUSH(tos);
+				break;
+			case PROG_DROP:
+				tos = NEXT;
+				break;
+			case PROG_SWAP:
+				value = stack[(sp - 1) & PROGRAM_STACK_MASK];
+				stack[(sp - 1) & PROGRAM_STACK_MASK] = tos;
+				tos = value;
+				break;
+			case PROG_OVER:
+// PUSH() moves the stack pointer before it takes the value, so read it first
+				value = stack[(sp - 1) & PROGRAM_STACK_MASK];
+				PUSH(value);
+				break;
+// int is 16 bits on the AVR, so signed arithmetic could overflow, which C leaves undefined.
+// The sums are done unsigned, which wraps round, and the product as unsigned int, which is the
+// same 16 bits on the AVR and wide enough on a host.
+			case PROG_ADD:
+				tos = (int16_t)((uint16_t)NEXT + (uint16_t)tos);
+				break;
+			case PROG_SUB:
+				tos = (int16_t)((uint16_t)NEXT - (uint16_t)tos);
+				break;
+			case PROG_MUL:
+				tos = (int16_t)((unsigned int)(uint16_t)NEXT * (uint16_t)tos);
+				break;
+			case PROG_SCALE:
+				tos = ((uint16_t)(uint8_t)NEXT * (uint8_t)tos) >> 8;
+				break;
+			case PROG_SHR:
+				tos = (uint16_t)tos >> (code[pc++] & 0x0F);
+				break;
+			case PROG_SHL:
+				tos = (uint16_t)tos << (code[pc++] & 0x0F);
+				break;
+			case PROG_AND:
+				tos = NEXT & tos;
+				break;
+			case PROG_OR:
+				tos = NEXT | tos;
+				break;
+			case PROG_XOR:
+				tos = NEXT ^ tos;
+				break;
+			case PROG_MIN:
+				value = NEXT;
+				if (value < tos)
+					tos = value;
+				break;
+			case PROG_MAX:
+				value = NEXT;
+				if (value > tos)
+					tos = value;
+				break;
+			case PROG_LT:
+				tos = NEXT < tos;
+				break;
+			case PROG_JZ:
+				value = tos;
+				tos = NEXT;
+				pc++;
+				if (value == 0)
+					pc += (int8_t)code[pc - 1];
+				break;
+			case PROG_JMP:
+				pc++;
+				pc += (int8_t)code[pc - 1];
+				break;
+			case PROG_LED:
+				PUSH(led);
+				break;
+			case PROG_LEDS:
+				PUSH(NUM_LEDS);
+				break;
+			case PROG_TIME:
+				PUSH(state->time);
+				break;
+			case PROG_PARAM:
+				PUSH(state->param);
+				break;
+			case PROG_RAND:
+				if (pixel != NULL)
+				{
+					programFaults++;
+					return steps;
+				}
+				PUSH(random16(&state->stream));
+				break;
+			case PROG_PATR:
+				PUSH((pattern != NULL) ? pattern[LED_RED] >> LED_FRAC_BITS : 0);
+				break;
+			case PROG_PATG:
+				PUSH((pattern != NULL) ? pattern[LED_GRN] >> LED_FRAC_BITS : 0);
+				break;
+			case PROG_PATB:
+				PUSH((pattern != NULL) ? pattern[LED_BLU] >> LED_FRAC_BITS : 0);
+				break;
+			case PROG_COS:
+				tos = pgm_read_byte(&envelopeThrob[tos & 0xFF]);
+				break;
+			case PROG_NOISE:
+				tos = noise2(NEXT, tos);
+				break;
+			case PROG_RGB:
+				rgb.blu = programClamp(tos);
+				rgb.grn = programClamp(NEXT);
+				rgb.red = programClamp(NEXT);
+				tos = NEXT;
+				if (pixel == NULL)
+					break;
+				pixel[LED_RED] = rgb.red;
+				pixel[LED_GRN] = rgb.grn;
+				pixel[LED_BLU] = rgb.blu;
+				break;
+			case PROG_HSV:
+				value = NEXT;
+				hsvToRgb(NEXT, programClamp(value), programClamp(tos), &rgb);
+				tos = NEXT;
+				if (pixel == NULL)
+					break;
+				pixel[LED_RED] = rgb.red;
+				pixel[LED_GRN] = rgb.grn;
+				pixel[LED_BLU] = rgb.blu;
+				break;
+			default:
+				programFaults++;
+				return steps;
+		}
+	}
+	return steps;
+}
+
+void programStart(ProgramState_t *state)
+{
+	randomStream(&state->stream);
+}
+
+void programRunFrame(ProgramState_t *state)
+{
+	if (programCode.pixelEntry != 0)
+		programExecute(&programCode, 0, state, 0, NULL, NULL);
+	state->time++;
+}
+
+void programRunPixel(ProgramState_t *state, uint16_t led, const ledval_t pattern[], uint8_t pixel[])
+{
+#if LED_CHANNELS == 4
+	pixel[LED_WHT] = 0;
+#endif
+	if (programCode.length == 0)
+	{
+		pixel[LED_RED] = pattern[LED_RED] >> LED_FRAC_BITS;
+		pixel[LED_GRN] = pattern[LED_GRN] >> LED_FRAC_BITS;
+		pixel[LED_BLU] = pattern[LED_BLU] >> LED_FRAC_BITS;
+		return;
+	}
+	pixel[LED_RED] = 0;
+	pixel[LED_GRN] = 0;
+	pixel[LED_BLU] = 0;
+	programExecute(&programCode, programCode.pixelEntry, state, led, pattern, pixel);
+}
+
+/*****************************************************************************
+	Loading and saving
+*****************************************************************************/
+static uint16_t programSum(const ProgramImage_t *image)
+{
+	uint16_t sum = 0;
+
+	for (uint8_t pc=0;pc<image->length;pc++)
+		sum += image->code[pc];
+	return sum;
+}
+
+// Checks the program put together in programIncoming and runs it from the next step
+static bool programInstall(void)
+{
+	if ((programIncoming.length > PROGRAM_SIZE) || (programIncoming.pixelEntry > programIncoming.length))
+		return false;
+	if (programSum(&programIncoming) != programIncoming.checksum)
+		return false;
+	memset(&programIncoming.code[programIncoming.length], 0, sizeof(programIncoming.code) - programIncoming.length);
+	memcpy(&programCode, &programIncoming, sizeof(ProgramImage_t));
+// The EEPROM would end up with parts of two programs
+	programSaveStep = PROGRAM_SAVE_IDLE;
+	return true;
+}
+
+bool programReceive(const LED_Program_t *chunk, uint8_t size)
+{
+	uint8_t bytes;
+
+	if (size <= offsetof(LED_Program_t, code))
+		return false;
+	bytes = size - offsetof(LED_Program_t, code);
+	if (chunk->offset == 0)
+	{
+// The controller sends the program again and again, and it only has to be taken once
+		if ((programCode.length != 0) && (chunk->id == programCode.id) && (chunk->checksum == programCode.checksum))
+			return false;
+		programIncoming.id = chunk->id;
+		programIncoming.length = chunk->length;
+		programIncoming.pixelEntry = chunk->pixelEntry;
+		programIncoming.checksum = chunk->checksum;
+		programReceived = 0;
+	} else if ((programReceived == 0) || (chunk->id != programIncoming.id) || (chunk->offset != programReceived))
+	{
+// A chunk was missed, so wait for the program to start again
+		programReceived = 0;
+		return false;
+	}
+	if ((chunk->length != programIncoming.length) || (chunk->length > PROGRAM_SIZE) || (chunk->offset >= chunk->length))
+	{
+		programReceived = 0;
+		return false;
+	}
+	if (bytes > chunk->length - chunk->offset)
+		bytes = chunk->length - chunk->offset;
+	memcpy(&programIncoming.code[chunk->offset], chunk->code, bytes);
+	programReceived = chunk->offset + bytes;
+	if (programReceived < programIncoming.length)
+		return false;
+	programReceived = 0;
+	if (!programInstall())
+		return false;
+	if (chunk->save != 0)
+		programSaveStep = 0;
+	return true;
+}
+
+void programRestore(void)
+{
+	eeprom_busy_wait();
+	if (eeprom_read_byte(&programSavedMagic) != PROGRAM_MAGIC)
+		return;
+	eeprom_read_block(&programIncoming, &programSaved, sizeof(ProgramImage_t));
+	programInstall();
+}
+
+/*****************************************************************************
+	Step 0 clears the valid mark, the steps after it write the bytes of the program, and the
+	last one sets the mark again.  eeprom_update_byte() leaves bytes that are already right,
+	and a step is only taken when the EEPROM has finished the last write, so this never waits.
+*****************************************************************************/
+void programSaveTick(void)
+{
+	if ((programSaveStep == PROGRAM_SAVE_IDLE) || !eeprom_is_ready())
+		return;
+	if (programSaveStep == 0)
+	{
+		eeprom_update_byte(&programSavedMagic, 0xFF);
+	} else if (programSaveStep <= sizeof(ProgramImage_t))
+	{
+		eeprom_update_byte((uint8_t *)&programSaved + programSaveStep - 1, ((const uint8_t *)&programCode)[programSaveStep - 1]);
+	} else
+	{
+		eeprom_update_byte(&programSavedMagic, PROGRAM_MAGIC);
+		programSaveStep = PROGRAM_SAVE_IDLE;
+		return;
+	}
+	programSaveStep++;
+}
+
+#ifdef LED_BENCHMARK
+/*****************************************************************************
+	Time PROGRAM_BENCH_PIXELS LEDs of programBenchCode[], and set the time per LED against the
+	CPU time per LED ledBenchmark() took to send the longest frame it tried.  The program is run
+	from programIncoming, so this has to run before anything can be received.
+*****************************************************************************/
+void programBenchmark(void)
+{
+	ProgramState_t state;
+	ledval_t pattern[LED_CHANNELS];
+	uint8_t pixel[LED_CHANNELS];
+	uint32_t start;
+	uint32_t cycles;
+	uint32_t sendCycles = 0;
+	uint16_t instructions = 0;
+
+	benchInit();
+	memset(&state, 0, sizeof(state));
+	memset(&programIncoming, 0, sizeof(programIncoming));
+	memcpy_P(programIncoming.code, programBenchCode, sizeof(programBenchCode));
+	programIncoming.length = sizeof(programBenchCode);
+	programIncoming.pixelEntry = 1;
+	for (uint8_t channel=0;channel<LED_CHANNELS;channel++)
+		pattern[channel] = LED_VALUE(64 + channel * 37);
+	start = benchTicks();
+	for (uint8_t led=0;led<PROGRAM_BENCH_PIXELS;led++)
+		instructions += programExecute(&programIncoming, 1, &state, led, pattern, pixel);
+	cycles = BENCH_TICKS_TO_CYCLES(benchTicks() - start) / PROGRAM_BENCH_PIXELS;
+	programBenchCycles = cycles;
+	programBenchInstructions = instructions / PROGRAM_BENCH_PIXELS;
+	programBenchIPS = (cycles != 0) ? (uint32_t)programBenchInstructions * F_CPU / cycles : 0;
+	for (uint8_t size=0;size<LED_BENCH_SIZES;size++)
+	{
+		if (ledBenchResults[size].numLEDs != 0)
+			sendCycles = ledBenchResults[size].callCycles / ledBenchResults[size].numLEDs;
+	}
+	programBench30fps = (F_CPU / 30) / (cycles + sendCycles);
+	memset(&programIncoming, 0, sizeof(programIncoming));
+}
+#endif // LED_BENCHMARK
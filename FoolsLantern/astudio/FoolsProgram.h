@@ -0,0 +1,119 @@
+/*
+	Effects sent over the radio as programs for a small stack machine, so a new effect does not
+	need new firmware in every lantern.  A program is up to PROGRAM_SIZE bytes of the instructions
+	below, in two parts: the frame code from the start, run once each step, and the pixel code from
+	pixelEntry, run for each LED to give its color.  With pixelEntry 0 there is no frame code.  The
+	pixel code has to give the same color each time it is run for an LED in a step, so it cannot
+	STORE or RAND, and a run that tries is stopped as a fault.  A program arrives in LED_Program_t
+	chunks on LEDProg_ENDPOINT and is run by the PROGRAM subMode.  tools/progc.py assembles one
+	from text.  See FoolsProgram.c.
+*/
+#ifndef _FOOLS_PROGRAM_H_
+#define _FOOLS_PROGRAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FoolsRandom.h"
+#include "LEDFrame.h"
+
+#define PROGRAM_REGISTERS			8			// Registers a program keeps from one step to the next
+#define PROGRAM_STACK				8			// Depth of the stack, a power of 2
+#define PROGRAM_MAX_STEPS			255			// Instructions one run of the frame or pixel code may take
+
+/*
+	The instructions.  The stack holds signed 16-bit values, and an instruction takes its
+	operands off the top, the last one pushed being its right-hand operand, and pushes its result.
+	Arithmetic wraps round.  Colors and the 8-bit instructions use the low 8 bits.
+	Those marked with a byte take one from the program after the instruction, PUSHW two.
+*/
+enum
+{
+	PROG_END,						// Stops the frame or pixel code
+	PROG_PUSH,						// byte: pushes 0 to 255
+	PROG_PUSHW,						// word: pushes a 16-bit value, low byte first
+	PROG_LOAD,						// byte: pushes register 0 to 7
+	PROG_STORE,						// byte: pops into register 0 to 7, frame code only
+	PROG_DUP,
+	PROG_DROP,
+	PROG_SWAP,
+	PROG_OVER,						// Pushes the value under the top
+	PROG_ADD,
+	PROG_SUB,
+	PROG_MUL,						// Low 16 bits of the product
+	PROG_SCALE,						// a * b / 256 of two 8-bit values, b out of 256 of a
+	PROG_SHR,						// byte: unsigned shift right
+	PROG_SHL,						// byte: shift left
+	PROG_AND,
+	PROG_OR,
+	PROG_XOR,
+	PROG_MIN,
+	PROG_MAX,
+	PROG_LT,						// 1 if a < b, else 0
+	PROG_JZ,						// byte: pops, and jumps -128 to 127 bytes from the next instruction if it was 0
+	PROG_JMP,						// byte: jumps -128 to 127 bytes from the next instruction
+	PROG_LED,						// Pushes the LED being drawn, 0 in the frame code
+	PROG_LEDS,						// Pushes the number of LEDs drawn
+	PROG_TIME,						// Pushes the steps since the effect started
+	PROG_PARAM,						// Pushes the modeParam of the command
+	PROG_RAND,						// Pushes a random 16-bit value, frame code only
+	PROG_PATR,						// Pushes the red, green or blue of the LED's pattern, 0 in the frame code
+	PROG_PATG,
+	PROG_PATB,
+	PROG_COS,						// 127.5 + 127.5 cos(a * 2 pi / 256), from FoolsEnvelopes.c
+	PROG_NOISE,						// noise2(a, b) from FoolsNoise.c
+	PROG_RGB,						// Pops blue, green and red, 0 to 255, as the color of the LED
+	PROG_HSV,						// Pops value, saturation and hue, 0 to 255, as the color of the LED
+	PROG_OPCODES
+};
+
+// What the PROGRAM effect keeps in EffectState_t
+typedef struct ProgramState_t {
+	int16_t		reg[PROGRAM_REGISTERS];
+	uint16_t	time;							// Steps since the effect started
+	uint16_t	param;							// modeParam of the command
+	RandomStream_t	stream;
+} ProgramState_t;
+
+// Starts a program effect, after the state has been cleared
+extern void programStart (ProgramState_t *state);
+
+// Runs the frame code, once each step before the pixels are drawn
+extern void programRunFrame (ProgramState_t *state);
+
+// Runs the pixel code for one LED, with pattern pointing at its LED_CHANNELS values of
+// LEDpattern, for its color in pixel.  With no program the LED shows the pattern.
+extern void programRunPixel (ProgramState_t *state, uint16_t led, const ledval_t pattern[],
+	uint8_t pixel[]);
+
+// FoolsModes.h has no guard against being included twice, so LED_Program_t is only declared here
+struct LED_Program_t;
+
+// Takes a chunk of a program from LEDProg_ENDPOINT.  True when it completed a new program,
+// which the PROGRAM effect runs from its next step.
+extern bool programReceive (const struct LED_Program_t *chunk, uint8_t size);
+
+// Runs the program saved in EEPROM, if there is one, once at start-up
+extern void programRestore (void);
+
+// Saves a program in EEPROM a byte at a time, when the last byte has been written.  Call every
+// LED_FRAME_INTERVAL from the frame timer, so the saving never holds the LEDs up.
+extern void programSaveTick (void);
+
+// Runs of the frame or pixel code stopped for taking more than PROGRAM_MAX_STEPS instructions,
+// for an instruction that is not in the list, or for a STORE or RAND in the pixel code
+extern volatile uint16_t programFaults;
+
+#ifdef LED_BENCHMARK
+#define PROGRAM_BENCH_PIXELS		64			// LEDs drawn by the program timed by programBenchmark()
+
+// CPU cycles and instructions per LED of a program that draws RAINBOW, instructions per second,
+// and the most LEDs it could draw and send at 30 fps in CPU time.  See FoolsProgram.c.
+extern volatile uint16_t programBenchCycles;
+extern volatile uint8_t programBenchInstructions;
+extern volatile uint32_t programBenchIPS;
+extern volatile uint16_t programBench30fps;
+
+extern void programBenchmark (void);
+#endif
+
+#endif // _FOOLS_PROGRAM_H_
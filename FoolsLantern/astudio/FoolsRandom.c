@@ -0,0 +1,70 @@
+/*
+ * \file FoolsRandom.c
+ *
+ * \brief Seeding of the effects' random number streams, and their benchmark
+ *
+ *	avr-libc's rand() is a 32-bit multiplicative generator and takes hundreds of cycles a
+ *	call on the AVR, which kept the effects to one draw per step.  The xorshift in
+ *	FoolsRandom.h is inline and takes a few tens, so RANDOM can twinkle each LED on its own.
+ *	With LED_BENCHMARK, randomBenchmark() leaves the cycles per draw of both in
+ *	randomBenchRandCycles and randomBenchXorshiftCycles, loop included.
+ */
+
+#include <stdlib.h>
+#include "config.h"
+#include "FoolsRandom.h"
+#include "LEDBench.h"
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+static RandomStream_t randomMaster = 0xACE1;
+
+#ifdef LED_BENCHMARK
+volatile uint16_t randomBenchRandCycles;
+volatile uint16_t randomBenchXorshiftCycles;
+#endif
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+void randomSeed(uint16_t seed)
+{
+	if (seed != 0)
+		randomMaster = seed;
+// The first few numbers from a small seed are small too
+	for (uint8_t count=0;count<8;count++)
+		random16(&randomMaster);
+}
+
+void randomStream(RandomStream_t *stream)
+{
+	*stream = random16(&randomMaster);
+}
+
+#ifdef LED_BENCHMARK
+/*****************************************************************************
+	Time RANDOM_BENCH_DRAWS draws of rand() and of random16().  The results go into a
+	volatile so that the draws are not optimised away.
+*****************************************************************************/
+void randomBenchmark(void)
+{
+	RandomStream_t stream;
+	volatile uint16_t sink;
+	uint32_t start;
+
+	benchInit();
+	start = benchTicks();
+	for (uint8_t count=0;count<RANDOM_BENCH_DRAWS;count++)
+		sink = rand();
+	randomBenchRandCycles = BENCH_TICKS_TO_CYCLES(benchTicks() - start) / RANDOM_BENCH_DRAWS;
+	randomStream(&stream);
+	start = benchTicks();
+	for (uint8_t count=0;count<RANDOM_BENCH_DRAWS;count++)
+		sink = random16(&stream);
+	randomBenchXorshiftCycles = BENCH_TICKS_TO_CYCLES(benchTicks() - start) / RANDOM_BENCH_DRAWS;
+	(void)sink;
+}
+#endif // LED_BENCHMARK
@@ -0,0 +1,55 @@
+/*
+	Random numbers for the effects.  Each effect keeps its own RandomStream_t in its state and
+	draws from it, so one effect's draws do not change another's sequence.  The generator is a
+	16-bit xorshift, a few shifts and exclusive ors with no multiply, cheap enough to draw once
+	per LED per step.  Streams are seeded from a master stream that randomSeed() seeds from the
+	node address, so every lantern runs a different sequence.
+*/
+#ifndef _FOOLS_RANDOM_H_
+#define _FOOLS_RANDOM_H_
+
+#include <stdint.h>
+
+typedef uint16_t RandomStream_t;				// Never 0, or it stays 0
+
+// Next number of a stream, 1 to 65535.  Shifts 7, 9, 8 give the full period of 65535.
+static inline uint16_t random16(RandomStream_t *stream)
+{
+	uint16_t x = *stream;
+
+	x ^= x << 7;
+	x ^= x >> 9;
+	x ^= x << 8;
+	*stream = x;
+	return x;
+}
+
+// The top 8 bits of the next number
+static inline uint8_t random8(RandomStream_t *stream)
+{
+	return random16(stream) >> 8;
+}
+
+// A number from 0 to range - 1, by multiplying rather than dividing
+static inline uint16_t randomRange(RandomStream_t *stream, uint16_t range)
+{
+	return ((uint32_t)random16(stream) * range) >> 16;
+}
+
+// Seeds the master stream, once at start-up
+extern void randomSeed (uint16_t seed);
+
+// Starts a new stream, from the next number of the master stream
+extern void randomStream (RandomStream_t *stream);
+
+#ifdef LED_BENCHMARK
+#define RANDOM_BENCH_DRAWS		64				// Draws timed by randomBenchmark()
+
+// Cycles per draw, avr-libc rand() against random16(), see FoolsRandom.c
+extern volatile uint16_t randomBenchRandCycles;
+extern volatile uint16_t randomBenchXorshiftCycles;
+
+extern void randomBenchmark (void);
+#endif
+
+#endif // _FOOLS_RANDOM_H_
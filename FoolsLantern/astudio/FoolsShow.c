@@ -0,0 +1,99 @@
+/*
+ * \file FoolsShow.c
+ *
+ * \brief Sequencer for the shows in flash that the lanterns play with no controller
+ *
+ *	The show keeps time in tenths of a second by counting frame ticks, so it runs off the same
+ *	timer that sends the LEDs and does not need one of its own.  Each tick costs one word read
+ *	from flash to see whether the next keyframe is due.  The keyframes are in time order and
+ *	the table ends with one whose subMode is SHOW_END.  When its time comes the show goes
+ *	round again from the top, so a show of a few minutes plays for as long as no commands
+ *	come in, with nothing sent over the radio.
+ *
+ *	The sequencer only says when a keyframe is due.  Starting it is left to the application,
+ *	in the same way as a command, so the effects cannot tell a keyframe from a command.
+ */
+
+#include <string.h>
+#include "config.h"
+#include "FoolsEffects.h"
+#include "FoolsShow.h"
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+static bool showOn = false;
+static uint16_t showIndex;							// Next keyframe in showTable[]
+static uint16_t showTime;							// Tenths of a second since the top of the show
+static uint16_t showMs;								// mS towards the next tenth
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+void showStart(void)
+{
+	showOn = true;
+	showIndex = 0;
+	showTime = 0;
+	showMs = 0;
+}
+
+void showStop(void)
+{
+	showOn = false;
+}
+
+bool showRunning(void)
+{
+	return showOn;
+}
+
+bool showTick(ShowKey_t *key)
+{
+	if (!showOn)
+		return false;
+	showMs += LED_FRAME_INTERVAL;
+	while (showMs >= SHOW_TIME_MS)
+	{
+		showMs -= SHOW_TIME_MS;
+		showTime++;
+	}
+	if (showTime < pgm_read_word(&showTable[showIndex].time))
+		return false;
+	memcpy_P(key, &showTable[showIndex], sizeof(ShowKey_t));
+	if (key->subMode == SHOW_END)
+	{
+// Round again, and the first keyframe is due straight away
+		showIndex = 0;
+		showTime = 0;
+		memcpy_P(key, &showTable[0], sizeof(ShowKey_t));
+	}
+	showIndex++;
+	return true;
+}
+
+/*****************************************************************************
+	Blend the pattern from the first color to the last along the strip, and start LEDarray
+	from it, as a command does
+*****************************************************************************/
+static uint8_t showMix(uint8_t first, uint8_t last, uint16_t weight)
+{
+	return ((uint16_t)first * (256 - weight) + (uint16_t)last * weight) >> 8;
+}
+
+void showPattern(const ShowKey_t *key)
+{
+	uint16_t weight;
+	uint16_t LED = 0;
+
+	for (ledindex_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr+=LED_CHANNELS)
+	{
+		weight = (NUM_LEDS > 1) ? ((uint32_t)LED++ << 8) / (NUM_LEDS - 1) : 0;
+		LEDpattern[LED_ptr+LED_RED] = LED_VALUE(showMix(key->first.red, key->last.red, weight));
+		LEDpattern[LED_ptr+LED_GRN] = LED_VALUE(showMix(key->first.grn, key->last.grn, weight));
+		LEDpattern[LED_ptr+LED_BLU] = LED_VALUE(showMix(key->first.blu, key->last.blu, weight));
+	}
+	memcpy(LEDarray, LEDpattern, LED_FRAME_BYTES * sizeof(ledval_t));
+}
@@ -0,0 +1,45 @@
+/*
+	Shows the lanterns play on their own, with no controller.  A show is a table of keyframes in
+	flash, each one saying when to change to which effect, with what pattern and modeParam, and
+	how long to crossfade into it.  showTable[] is in FoolsShowData.c, which is made from a text
+	show by tools/showc.py, so a show is changed by editing the text and running the tool, not
+	by editing the table.
+*/
+#ifndef _FOOLS_SHOW_H_
+#define _FOOLS_SHOW_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/pgmspace.h>
+#include "FoolsColor.h"
+
+#define SHOW_TIME_MS				100			// mS in one unit of ShowKey_t time and fade
+#define SHOW_END					0xFF		// subMode of the last keyframe, the show starts again at its time
+
+typedef struct ShowKey_t {
+	uint16_t	time;							// Tenths of a second from the start of the show
+	uint8_t		subMode;						// Effect to run from then on, or SHOW_END
+	uint8_t		fade;							// Tenths of a second to crossfade into it, 0 to cut
+	uint16_t	modeParam;						// Passed to the effect, as in LED_Command_t
+	uint16_t	period_mS;						// Time between animation steps
+	RgbColor_t	first;							// The pattern is a blend from the first LED's color
+	RgbColor_t	last;							// to the last LED's
+} ShowKey_t;
+
+extern const ShowKey_t showTable[] PROGMEM;
+
+// Starts the show from the top.  The first keyframe comes out of the next showTick().
+extern void showStart (void);
+
+extern void showStop (void);
+
+extern bool showRunning (void);
+
+// Moves the show on by one frame tick.  Call every LED_FRAME_INTERVAL from the frame timer.
+// True when a keyframe is due, which is copied into key for the application to start.
+extern bool showTick (ShowKey_t *key);
+
+// Fills LEDpattern and LEDarray with the pattern of a keyframe
+extern void showPattern (const ShowKey_t *key);
+
+#endif // _FOOLS_SHOW_H_
@@ -0,0 +1,25 @@
+/*
+ * \file FoolsShowData.c
+ *
+ * \brief The show the lanterns play with no controller, made from local.show
+ *
+ *	Made by tools/showc.py, so edit local.show and run it again rather than editing this.
+ */
+
+#include "config.h"
+#include "FoolsModes.h"
+#include "FoolsShow.h"
+
+const ShowKey_t showTable[] PROGMEM =
+{
+//	  time	subMode			fade	param	period	first				last
+	{     0,	BREATHE,		 30,	0x1388,	   62,	{0x00,0x00,0xC4},	{0x00,0x00,0xC4} },
+	{   200,	RAINBOW,		 30,	0x0000,	   40,	{0xFF,0xFF,0xFF},	{0xFF,0xFF,0xFF} },
+	{   450,	ROTATE,			 20,	0x0001,	  125,	{0xFF,0x40,0x00},	{0x00,0x20,0xFF} },
+	{   650,	PARTICLES,		 20,	0x0001,	   16,	{0xFF,0xA0,0x40},	{0xFF,0xA0,0x40} },
+	{   900,	THROB,			 20,	0x1F40,	   62,	{0xC0,0x00,0x60},	{0x60,0x00,0xC0} },
+	{  1100,	RANDOM,			 10,	0x9000,	   62,	{0xFF,0xFF,0xFF},	{0x40,0xA0,0xFF} },
+	{  1300,	FIRECRACKER,	 10,	0x0028,	   62,	{0x00,0x00,0x00},	{0x00,0x00,0x00} },
+	{  1600,	RAINBOW,		 30,	0xFD10,	   40,	{0xFF,0xFF,0xFF},	{0xFF,0xFF,0xFF} },
+	{  1800,	SHOW_END,		  0,	0x0000,	    0,	{0x00,0x00,0x00},	{0x00,0x00,0x00} },
+};
@@ -1,87 +1,169 @@
 #include <avr/io.h>
+#include "config.h"
+
+#if (LED_DRIVER == LED_DRIVER_BITBANG) || (LED_DRIVER == LED_DRIVER_BITBANG_WINDOWED)
+#include "WS2812Timing.h"
+#include "LEDFormat.h"
+.global ledSendBytes
+#if LED_DRIVER == LED_DRIVER_BITBANG
 .global updateLEDs
+#endif
 
-//Use r18-r27, r30, r31
-//Don't use r2-r17, r28, r29
-/*	This function receives a pointer to an array of LED intensity=ies in green / red / blue order,
-	along with the length in bytes.  It outputs the bits of the array in the format defined for
+//Use r18-r27, r30, r31, and r0, r1 with LED_GAMMA (ledSendBytes leaves r18 alone)
+//Don't use r2-r17; r28, r29 are saved and restored
+/*	This function receives a pointer to an array of LED intensities in red / green / blue (white)
+	order, along with the length in bytes.  The bytes of each LED are sent in the order the strip
+	takes them, set by LED_FORMAT in config.h (see LEDFormat.h).  It outputs the bits of the array in the format defined for
 	the WS2811 LED driver and WS2812 LED with integrated driver.  Timing is written for 800kHz
-	bit rate with 250nS on time for zeroes and 1000nS (1 uS) on time for ones.  This function is
+	bit rate with about 350nS on time for zeroes and 800nS on time for ones.  This function is
 	time-critical, so interrupts are turned off while it runs and restored upon exit.
 
+	The bits are sent by ledSendBytes, which takes the same parameters and expects interrupts
+	to be off already.  updateLEDs wraps it for the plain bit-banged driver.  LEDWindowed.c
+	calls it one LED at a time instead, so that interrupts can run in between.
+
 	The address of the array of bytes is expected in registers 24 and 25.  The number of bytes
 	in the form of a two-byte integer is expected in registers 22 and 23.  Note that this is the
-	number of bytes, not the number of LEDs, as there are 3 color intensity bytes per LED.
-		
-	Note that a 16 MHz processor clock / instruction executing rate is assumed.  The number at
-	the start of most comments is the number of clock cycles required to execute that instruction.
-	Branches have two outcomes: more instruction cycles if the branch is taken and fewer if not.
-	This feature is used to equalize the timing between 0 and 1 bit sequences.  If you count the
-	instruction eecution cycles, assume that the digital output pins do not change until the
-	end of the instruction, which is after the second instruction cycle.  This really does not
-	matter as long as you are consistent in the way you treat the instruction timing.
+	number of bytes, not the number of LEDs, as there are LED_CHANNELS color intensity bytes per
+	LED.  Whole LEDs are sent until fewer than LED_CHANNELS bytes are left, so strips of several
+	hundred LEDs are fine, and a count of zero sends nothing.
+
+	The delays are worked out from F_CPU when this file is assembled, so the same code is right
+	for 8, 12, 16 and 20 MHz.  F_CPU has to be passed to the assembler (see the assembler flags in
+	the project and the make files) as a plain number, without a UL suffix.  The number at the
+	start of most comments is the number of clock cycles required to execute that instruction.
+	The output pin changes at the end of the OUT instruction.  The SBRS/OUT pair takes two cycles
+	whether or not the OUT is skipped, which keeps the timing of 0 and 1 bits equal.
 
-	To Do:  Fix the fact that an extra bit is sent out because the exit branch is taken on the
-	first execution of the bit loop for a non-existent byte (off the end of the array).  This
-	doesn't really cause any harm unless the function is handed a number of bytes that is smaller
-	than the actual number of LEDs (x3 for R, G, and B).
+	One bit, counted from the OUT that sets the pin high:
+		T0H   = W1 + 2 cycles
+		T1H   = W1 + W2 + 4 cycles
+		TBIT  = W1 + W2 + W3 + 8 cycles
+	The last bit of each byte gets 10 extra cycles of low time while the next byte is picked out
+	of the LED and SendByte is called, and 7 more at the end of each LED, which the LEDs ignore
+	(anything well short of the latch time is fine).  With LED_GAMMA the next byte is also gamma
+	corrected and scaled by ledBrightness in that gap, which takes 11 more cycles, so the LED
+	array does not need a separate pass.
 */
-#define BOARD_VERSION 1
-// This parameter changes the output pin for the serial data.
+
+// The output pin for the serial data follows the board version in config.h
 #if BOARD_VERSION == 1
 // Version 1 will output the serial data on pin 3 of port E
 // This pin is on the 8 dual-pin header strip next to the ISP connector
-#define PORTD 0x0E
-#define PD4 3
+#define LED_DATA_PORT 0x0E
+#define LED_DATA_BIT 3
 #elif BOARD_VERSION == 2
 // Version 2 will output the serial data on pin 4 of port D
 // this pin is brought out to the S-LED connector along with battery power and ground
-#define PORTD 0x0B
-#define PD4 4
+#define LED_DATA_PORT 0x0B
+#define LED_DATA_BIT 4
 #else
+#error "LED2812.s: unknown BOARD_VERSION"
 #endif
 
-updateLEDs:			// Preamble to  load parameters, save state, and prevent interrupts
-			mov		r30, r24				// Get the pointer to the array of bytes
-			mov		r31, r25				// Put it into the Z register (R30/R31)
-			mov		r26, r22				// Load the outer loop counter
-			mov		r27, r23				// Load the outer loop counter
-			adiw 	r26, 1					// Add one to outer loop count so last bit goes out
+// Gamma correction and brightness of the byte in r19, see LEDGamma.c.  This runs between bytes,
+// where the line is already resting low, and uses Z, r0, r1 and the brightness in r23.  With
+// LED_DITHER, LEDFrame.c has already corrected the bytes.
+#if defined(LED_GAMMA) && !defined(LED_DITHER)
+#define LED_SCALE_BYTES
+#endif
 
+.macro		scale
+#ifdef LED_SCALE_BYTES
+			mov		r30, r19				//1 The table is aligned, so r31 holds the high byte
+			lpm		r19, Z					//3 Gamma corrected value
+			mul		r19, r23				//2 Scale by ledBrightness + 1
+			add		r0, r19					//1
+			brcc	.+2						//1/2
+			inc		r1						//1
+			mov		r19, r1					//1
+#endif
+.endm
+
+// Padding cycles in each part of the bit (see the timing above)
+#define LED_W1				(NS_TO_CYCLES(WS2812_T0H)-2)
+#define LED_W2				(NS_TO_CYCLES(WS2812_T1H)-NS_TO_CYCLES(WS2812_T0H)-2)
+#define LED_W3				(NS_TO_CYCLES(WS2812_TBIT)-LED_W1-LED_W2-8)
+
+// Fail the build rather than send bits the LEDs will misread
+#if (LED_W1 < 0) || (LED_W2 < 0) || (LED_W3 < 0)
+#error "LED2812.s: F_CPU is too slow for the WS2812 bit loop"
+#endif
+#if (CYCLES_TO_NS(LED_W1 + 2) < WS2812_T0H_MIN) || (CYCLES_TO_NS(LED_W1 + 2) > WS2812_T0H_MAX)
+#error "LED2812.s: T0H cannot be met at this F_CPU"
+#endif
+#if (CYCLES_TO_NS(LED_W1 + LED_W2 + 4) < WS2812_T1H_MIN) || (CYCLES_TO_NS(LED_W1 + LED_W2 + 4) > WS2812_T1H_MAX)
+#error "LED2812.s: T1H cannot be met at this F_CPU"
+#endif
+#if (CYCLES_TO_NS(LED_W1 + LED_W2 + LED_W3 + 8) < WS2812_TBIT_MIN) || (CYCLES_TO_NS(LED_W1 + LED_W2 + LED_W3 + 8) > WS2812_TBIT_MAX)
+#error "LED2812.s: the bit period cannot be met at this F_CPU"
+#endif
+
+#if LED_DRIVER == LED_DRIVER_BITBANG
+updateLEDs:			// Save state and prevent interrupts for the whole frame
 			in 		r18, 0x3F				// Save status register
 			cli								// Turn off interrupts
-//			sbi		0x0e,7
-			ld		r19, Z+					// Get the first byte and increment the array pointer
+			rcall	ledSendBytes			// Send the frame, this leaves r18 alone
+			out 	0x3F, r18				// Restore the status register (and interrupt flag)
+			ret
+#endif
+
+ledSendBytes:		// Preamble to load parameters, interrupts are already off
+			push	r28						// Y is call-saved
+			push	r29
+			movw	r28, r24				// Get the pointer to the array of bytes into Y
+			movw	r24, r22				// Load the byte counter
+			in		r22, LED_DATA_PORT		// Output levels for low and high that leave the
+			mov		r21, r22				// other pins on the port as they are
+			ori		r21, (1 << LED_DATA_BIT)
+			andi	r22, ~(1 << LED_DATA_BIT) & 0xFF
+#ifdef LED_SCALE_BYTES
+			ldi		r31, hi8(ledGamma)		// Point Z at the gamma table
+			lds		r23, ledBrightness		// and get the brightness for the whole frame
+#endif
+/**************************************************************************************/
+/* Loop over LEDs, sending the bytes of each in wire order */
+PixelLoop:
+			sbiw	r24, LED_CHANNELS		//2 Count off one LED
+			brcs	Exit					//1/2 Exit when there is not a whole LED left
+			ldd		r19, Y+LED_WIRE_0		//2 Pick the bytes of this LED out in wire order
+			rcall	SendByte				//3
+			ldd		r19, Y+LED_WIRE_1
+			rcall	SendByte
+			ldd		r19, Y+LED_WIRE_2
+			rcall	SendByte
+#if LED_CHANNELS == 4
+			ldd		r19, Y+LED_WIRE_3
+			rcall	SendByte
+#endif
+			adiw	r28, LED_CHANNELS		//2 On to the next LED
+			rjmp	PixelLoop				//2
 /**************************************************************************************/
-ByteLoop:
-			ldi 	r20, 8					//1 Load/reload bit count
+Exit:
+#ifdef LED_SCALE_BYTES
+			clr		r1						// The compiler expects r1 to be zero
+#endif
+			pop		r29
+			pop		r28
+			ret
+
+/**************************************************************************************/
+SendByte:			// Send the byte in r19, most significant bit first
+			scale
+			ldi 	r20, 8					//1 Load bit count
 /* Loop over 8 bits */
 BitLoop:
-			sbi  	PORTD,PD4				//2 Output high; does not occur until end of instruction
-			nop								//1 62.5 nS delay
-			sbrc 	r19, 7					//1/2 Check if upper bit is 0 or 1
-			rjmp 	Bit1					//2 For 1, this branch is taken (not skipped)
-			cbi  	PORTD,PD4				//2 For 0, the previous branch is skipped and this is done
-Bit1:										// (For 1, the output is cleared later)
-			sbrc 	r19, 7					//1/2 Check if upper bit is 0 or 1
-			rjmp 	Here					//2 For 1, this adds an instruction cycle
-Here:
-			nop								//1 62.5 nS delay
-			sbiw 	r26, 1					//2 Decrement outer loop counter
-			breq 	Exit					//1/2 exit outer loop if zero
-			adiw 	r26, 1					//2 Bump outer loop counter back up
+			out		LED_DATA_PORT, r21		//1 Output high
+			delay	LED_W1
+			sbrs	r19, 7					//1/2 For 1, skip the next instruction
+			out		LED_DATA_PORT, r22		//1 For 0, output low after T0H
 			lsl 	r19						//1 Move next bit in
+			delay	LED_W2
+			out		LED_DATA_PORT, r22		//1 For 1, output low after T1H
+			delay	LED_W3
 			dec 	r20						//1 Decrement inner loop counter
-			cbi 	PORTD,PD4				//2 Clear output to low
 			brne 	BitLoop					//1/2 Send next bit
-			ld 		r19, Z+					//2 load in next byte
-			sbiw 	r26, 1					//2 Decrement outer loop counter
-			rjmp 	ByteLoop				//2 Restart loop with new byte
+			ret								//4
 /**************************************************************************************/
-Exit:
-			nop								//1 62.5 nS delay
-			cbi 	PORTD,PD4				// Make sure output is low
-			out 	0x3F, r18				// Restore the status register
-//			cbi		0x0e,7
-			sei								// Turn interrupts back on
-			ret
\ No newline at end of file
+
+#endif // LED_DRIVER_BITBANG || LED_DRIVER_BITBANG_WINDOWED
@@ -0,0 +1,181 @@
+/*
+ * \file LEDApa102.c
+ *
+ * \brief APA102 / SK9822 output through the hardware SPI, interrupt driven
+ *
+ *	These strips have a clock line as well as data, so the timing comes from the SPI clock and
+ *	the strip waits for as long as it takes between bytes.  Nothing has to run with interrupts
+ *	off.  updateLEDs() encodes the frame into apaFrame[] and returns right away, and the SPI
+ *	transfer complete interrupt then feeds the rest of it one byte at a time.  The AVR SPI has
+ *	no transmit buffer, so there is a short gap between bytes while the interrupt gets in,
+ *	which the strip does not mind.
+ *
+ *	A frame is a start frame of 32 zero bits, then 4 bytes per LED: 0xE0 plus a 5-bit global
+ *	brightness, then blue, green and red.  Each LED passes the data on half a clock late, so
+ *	the end frame has to carry at least NUM_LEDS/2 more clocks to push the data to the last LED.
+ *	The end frame is sent as zeros: the SK9822 needs another 32 zero bits to latch the frame,
+ *	and to the APA102 they are just the start of a frame that never comes.
+ *
+ *	With LED_GAMMA, ledBrightness is split between the 5-bit field and the color bytes.  The
+ *	field takes the smallest step that reaches the brightness and the colors are scaled by the
+ *	rest, so dimming the strip keeps nearly all 8 bits of color resolution instead of losing
+ *	the bottom bits as the WS2812 drivers do.  With LED_DITHER the colors have already been
+ *	scaled by LEDFrame.c and the field stays at full.
+ *
+ *	Data is on MOSI (PB2) and the clock on SCK (PB1).  SS (PB0) is made an output so that the
+ *	SPI stays in master mode.
+ */
+
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "config.h"
+#include "LEDDriver.h"
+#include "LEDGamma.h"
+#include "LEDFormat.h"
+
+#if LED_DRIVER == LED_DRIVER_APA102
+
+/*****************************************************************************
+ Preprocessor definitions
+*****************************************************************************/
+
+// SPI clock prescaler, SPR1:0 in SPCR and SPI2X in SPSR
+#if LED_APA102_CLOCK_DIV == 2
+#define APA102_SPCR			0
+#define APA102_SPSR			(1 << SPI2X)
+#elif LED_APA102_CLOCK_DIV == 4
+#define APA102_SPCR			0
+#define APA102_SPSR			0
+#elif LED_APA102_CLOCK_DIV == 8
+#define APA102_SPCR			(1 << SPR0)
+#define APA102_SPSR			(1 << SPI2X)
+#elif LED_APA102_CLOCK_DIV == 16
+#define APA102_SPCR			(1 << SPR0)
+#define APA102_SPSR			0
+#elif LED_APA102_CLOCK_DIV == 32
+#define APA102_SPCR			(1 << SPR1)
+#define APA102_SPSR			(1 << SPI2X)
+#elif LED_APA102_CLOCK_DIV == 64
+#define APA102_SPCR			(1 << SPR1)
+#define APA102_SPSR			0
+#elif LED_APA102_CLOCK_DIV == 128
+#define APA102_SPCR			((1 << SPR1) | (1 << SPR0))
+#define APA102_SPSR			0
+#else
+#error "LEDApa102.c: LED_APA102_CLOCK_DIV has to be 2, 4, 8, 16, 32, 64 or 128"
+#endif
+
+#define APA102_LED_START		0xE0			// Top 3 bits of the first byte of each LED
+#define APA102_BRIGHTNESS_MAX	31
+#define APA102_START_BYTES		4
+#define APA102_END_BYTES(n)		(4 + ((n) + 15) / 16)	// 32 zero bits plus n/2 clocks
+#define APA102_FRAME_SIZE		(APA102_START_BYTES + NUM_LEDS*4 + APA102_END_BYTES(NUM_LEDS))
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+static const uint8_t wireOrder[LED_CHANNELS] = LED_WIRE_ORDER;
+static uint8_t apaFrame[APA102_FRAME_SIZE];
+static uint8_t * volatile apaNext;
+static uint8_t *apaEnd;
+static volatile bool apaBusy = false;
+static bool apaReady = false;
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+/*****************************************************************************
+	SPI master, MSB first, mode 0, at F_CPU / LED_APA102_CLOCK_DIV
+*****************************************************************************/
+static void ledApaInit(void)
+{
+	DDRB |= (1 << PB0) | (1 << PB1) | (1 << PB2);
+	SPCR = (1 << SPE) | (1 << MSTR) | APA102_SPCR;
+	SPSR = APA102_SPSR;
+	apaReady = true;
+}
+
+/*****************************************************************************
+	Encode the array of color bytes and start sending it.  This only waits if the previous
+	frame is still going out.
+*****************************************************************************/
+void updateLEDs(uint8_t colorArray[], uint16_t numLEDs)
+{
+	uint8_t *apaPtr = apaFrame;
+	uint8_t header = APA102_LED_START | APA102_BRIGHTNESS_MAX;
+#if defined(LED_GAMMA) && !defined(LED_DITHER)
+	uint8_t brightness = ledBrightness;
+	uint8_t field;
+	uint16_t colorScale;
+	uint8_t value;
+#endif
+
+	if (numLEDs > LED_FRAME_BYTES)
+		numLEDs = LED_FRAME_BYTES;
+	numLEDs -= numLEDs % LED_CHANNELS;				// Whole LEDs only
+	if (!apaReady)
+		ledApaInit();
+	while (apaBusy)
+		;
+#if defined(LED_GAMMA) && !defined(LED_DITHER)
+// Smallest field that reaches the brightness, and what is left over to scale the colors by (0-256)
+	field = ((uint16_t)brightness * APA102_BRIGHTNESS_MAX + 254) / 255;
+	if (field == 0)
+		field = 1;
+	colorScale = ((uint16_t)(brightness + 1) * APA102_BRIGHTNESS_MAX + field / 2) / field;
+	if (colorScale > 256)
+		colorScale = 256;
+	header = APA102_LED_START | field;
+#endif
+	for (uint8_t count=0;count<APA102_START_BYTES;count++)
+		*apaPtr++ = 0;
+	for (uint16_t LED_ptr=0;LED_ptr<numLEDs;LED_ptr+=LED_CHANNELS)
+	{
+		*apaPtr++ = header;
+		for (uint8_t channel=0;channel<LED_CHANNELS;channel++)
+		{
+#if defined(LED_GAMMA) && !defined(LED_DITHER)
+			value = pgm_read_byte(&ledGamma[colorArray[LED_ptr + wireOrder[channel]]]);
+			*apaPtr++ = (value * colorScale) >> 8;
+#else
+			*apaPtr++ = colorArray[LED_ptr + wireOrder[channel]];
+#endif
+		}
+	}
+	for (uint16_t count=0;count<APA102_END_BYTES(numLEDs/LED_CHANNELS);count++)
+		*apaPtr++ = 0;
+	apaEnd = apaPtr;
+	apaNext = &apaFrame[1];
+	apaBusy = true;
+	SPCR |= (1 << SPIE);
+	SPDR = apaFrame[0];
+}
+
+/*****************************************************************************
+	True while a frame is still going out
+*****************************************************************************/
+bool ledSpiBusy(void)
+{
+	return apaBusy;
+}
+
+/*****************************************************************************
+	The last byte has been clocked out: hand the SPI the next one, or finish the frame
+*****************************************************************************/
+ISR(SPI_STC_vect)
+{
+	if (apaNext != apaEnd)
+	{
+		SPDR = *apaNext++;
+	} else
+	{
+		SPCR &= ~(1 << SPIE);
+		apaBusy = false;
+	}
+}
+
+#endif // LED_DRIVER_APA102
@@ -0,0 +1,161 @@
+/*
+ * \file LEDBench.c
+ *
+ * \brief Timing measurements for the LED code
+ *
+ *	Built only when LED_BENCHMARK is defined in config.h.  Timer5 runs free at F_CPU/8 and its
+ *	overflows are counted, so benchTicks() gives a 32-bit time stamp.  The lantern has no console,
+ *	so the results are left in RAM (ledBenchResults) to be read with the debugger.
+ *
+ *	ledBenchmark() times one frame of 16, 64, 150 and 300 LEDs through the selected driver,
+ *	skipping any that are longer than NUM_LEDS.  For comparison, the wire time of a WS2812 frame
+ *	is 30 uS per LED (24 bits of 1.25 uS) plus the 50 uS latch, and 40 uS per LED for RGBW:
+ *		16 LEDs		  530 uS	1886 fps
+ *		64 LEDs		 1970 uS	 507 fps
+ *		150 LEDs	 4550 uS	 219 fps
+ *		300 LEDs	 9050 uS	 110 fps
+ *	The bit-banged driver spends all of that in updateLEDs() with interrupts off, which is
+ *	480 cycles per LED at 16 MHz, 69120 cycles for 144 LEDs.  The USART driver only spends
+ *	the encoding time there.  The parallel driver sends the same number of LEDs split across its
+ *	strips, so its frame time drops by the number of strips.
+ *
+ *	The APA102 driver also only spends the encoding time in updateLEDs(), about 70 cycles per
+ *	LED, with interrupts on.  Its frame is 4 bytes per LED plus 8 bytes of start and end frame
+ *	and one more for every 16 LEDs, and each byte takes 8 SPI clocks plus the few cycles it takes the interrupt to load
+ *	the next one.  At 16 MHz with the default LED_APA102_CLOCK_DIV of 8 that is about 5.5 uS a
+ *	byte, so no latch time is needed:
+ *		16 LEDs		  400 uS	2500 fps
+ *		64 LEDs		 1460 uS	 680 fps
+ *		144 LEDs	 3260 uS	 300 fps
+ *	Compare callCycles against the bit-banged figure above to see the CPU time given back.
+ *
+ *	While running, the time of each animation step is left in ledBenchRenderCycles and the time
+ *	of each frame tick that sent something in ledBenchOutputCycles, so the cost of drawing a
+ *	frame can be set against the cost of sending it.  Against LED_FRAME_INTERVAL they show how
+ *	much of the CPU the LEDs take.
+ *
+ *	With LED_DITHER, every tick also pays for the conversion in LEDFrame.c, which is timed on
+ *	each tick into ledBenchDitherCycles.  Divide by LED_FRAME_BYTES for the cost per byte.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/delay.h>
+#include "config.h"
+#include "LEDDriver.h"
+#include "LEDBench.h"
+
+#ifdef LED_BENCHMARK
+
+/*****************************************************************************
+ Preprocessor definitions
+*****************************************************************************/
+
+#if LED_DRIVER == LED_DRIVER_APA102
+#define LED_BENCH_LATCH_US		0				// Clocked strips latch on the end frame
+#else
+#define LED_BENCH_LATCH_US		50				// Low time the strip needs between frames
+#endif
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+static const uint16_t benchSizes[LED_BENCH_SIZES] = {16, 64, 150, 300};
+static volatile uint16_t benchOverflows;
+static bool benchRunning = false;
+
+volatile LEDBenchResult_t ledBenchResults[LED_BENCH_SIZES];
+volatile uint32_t ledBenchRenderCycles;
+volatile uint32_t ledBenchOutputCycles;
+#ifdef LED_DITHER
+volatile uint32_t ledBenchDitherCycles;
+#endif
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+/*****************************************************************************
+	Start Timer5 counting at F_CPU/8 in normal mode
+*****************************************************************************/
+void benchInit(void)
+{
+	if (benchRunning)
+		return;
+	TCCR5A = 0;
+	TCCR5B = (1 << CS51);
+	TIFR5 = (1 << TOV5);
+	TIMSK5 = (1 << TOIE5);
+	benchRunning = true;
+}
+
+/*****************************************************************************
+	Time stamp in Timer5 ticks.  This is safe to call with interrupts off, as long as they
+	have not been off for more than one overflow (32 mS at 16 MHz).
+*****************************************************************************/
+uint32_t benchTicks(void)
+{
+	uint16_t count;
+	uint16_t overflows;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		count = TCNT5;
+		overflows = benchOverflows;
+// An overflow that has not been serviced yet belongs to this reading if the count is small
+		if ((TIFR5 & (1 << TOV5)) && (count < 0x8000))
+			overflows++;
+	}
+	return ((uint32_t)overflows << 16) | count;
+}
+
+ISR(TIMER5_OVF_vect)
+{
+	benchOverflows++;
+}
+
+/*****************************************************************************
+	Time one frame of each length through updateLEDs().  The array has to hold LED_FRAME_BYTES
+	bytes.  It is filled with a dim value that is still not zero after gamma correction, so that
+	the drivers do their full work without lighting up the strip, and is cleared again at the end.
+*****************************************************************************/
+void ledBenchmark(uint8_t colorArray[])
+{
+	uint32_t start;
+	uint32_t callTime;
+	uint32_t frameTime;
+
+	benchInit();
+	for (uint16_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr++)
+		colorArray[LED_ptr] = 0x10;
+	for (uint8_t size=0;size<LED_BENCH_SIZES;size++)
+	{
+		if (benchSizes[size] > NUM_LEDS)
+		{
+			ledBenchResults[size].numLEDs = 0;
+			continue;
+		}
+		_delay_us(LED_BENCH_LATCH_US);
+		start = benchTicks();
+		updateLEDs(colorArray, benchSizes[size]*LED_CHANNELS);
+		callTime = benchTicks() - start;
+		ledBenchResults[size].callCycles = BENCH_TICKS_TO_CYCLES(callTime);
+		ledBenchResults[size].callTime_uS = BENCH_TICKS_TO_US(callTime);
+#if (LED_DRIVER == LED_DRIVER_USART_SPI) || (LED_DRIVER == LED_DRIVER_APA102)
+		while (ledSpiBusy())
+			;
+#endif
+		frameTime = BENCH_TICKS_TO_US(benchTicks() - start) + LED_BENCH_LATCH_US;
+		ledBenchResults[size].frameTime_uS = frameTime;
+		ledBenchResults[size].maxFPS = 1000000UL / frameTime;
+		ledBenchResults[size].numLEDs = benchSizes[size];
+	}
+	for (uint16_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr++)
+		colorArray[LED_ptr] = 0;
+	_delay_us(LED_BENCH_LATCH_US);
+	updateLEDs(colorArray, LED_FRAME_BYTES);
+}
+
+#endif // LED_BENCHMARK
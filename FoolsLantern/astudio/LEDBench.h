@@ -0,0 +1,39 @@
+/*
+	Timing measurements for the LED code, built when LED_BENCHMARK is defined in config.h.
+	The results are left in RAM to be read with the debugger.
+*/
+#ifndef _LED_BENCH_H_
+#define _LED_BENCH_H_
+
+#include <stdint.h>
+
+#ifdef LED_BENCHMARK
+
+// Timer5 runs free at F_CPU/8 while benchmarks are running
+#define BENCH_TICKS_TO_US(t)		((t) * 8 / (F_CPU / 1000000UL))
+#define BENCH_TICKS_TO_CYCLES(t)	((t) * 8)
+
+#define LED_BENCH_SIZES				4			// Number of strip lengths the output path is timed for
+
+typedef struct LEDBenchResult_t {
+	uint16_t	numLEDs;					// LEDs in the frame, 0 if this is more than NUM_LEDS
+	uint32_t	callCycles;					// CPU cycles spent in updateLEDs()
+	uint32_t	callTime_uS;				// Time spent in updateLEDs()
+	uint32_t	frameTime_uS;				// Time until the frame has gone out, plus the latch time
+	uint16_t	maxFPS;						// Frames per second the strip can be sent at this length
+} LEDBenchResult_t;
+
+extern volatile LEDBenchResult_t ledBenchResults[LED_BENCH_SIZES];
+extern volatile uint32_t ledBenchRenderCycles;	// Cycles spent on the last animation step
+extern volatile uint32_t ledBenchOutputCycles;	// Cycles spent sending the last frame, see LEDFrame.c
+#ifdef LED_DITHER
+extern volatile uint32_t ledBenchDitherCycles;	// Cycles spent dithering the last frame, see LEDFrame.c
+#endif
+
+extern void benchInit (void);
+extern uint32_t benchTicks (void);
+extern void ledBenchmark (uint8_t colorArray[]);
+
+#endif // LED_BENCHMARK
+
+#endif // _LED_BENCH_H_
@@ -0,0 +1,57 @@
+/*
+	Interface to the LED strip output drivers.  Only the driver picked by LED_DRIVER in config.h
+	is built, and every driver provides updateLEDs() with the same arguments, so the application
+	code does not change when the driver does.
+*/
+#ifndef _LED_DRIVER_H_
+#define _LED_DRIVER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Sends the array of color bytes to the strip.  Note that numLEDs is the number of bytes,
+// not the number of LEDs, as there are LED_CHANNELS color intensity bytes per LED.  The bytes
+// are in the order of LEDFormat.h and only whole LEDs are sent.
+extern void updateLEDs (uint8_t colorArray[], uint16_t numLEDs);
+
+#ifdef LED_STREAM_LEDS
+// Works out the color of one LED, from 0 at the start of the strip, into LED_CHANNELS bytes at
+// the offsets in LEDFormat.h.  It has to give the same color for the same LED every time it is
+// called for a frame, and has to be quick, see LEDStream.c.
+typedef void (*LEDPixel_t)(uint16_t led, uint8_t pixel[]);
+
+// Sends numLEDs LEDs, asking the pixel function for each one just before it goes out.  Unlike
+// updateLEDs(), numLEDs is the number of LEDs.
+extern void updateLEDsStream (LEDPixel_t pixel, uint16_t numLEDs);
+
+// Number of frames started again because drawing an LED and the interrupts in between took
+// longer than LED_LATCH_GUARD_US, and number of frames given up after too many restarts.
+extern volatile uint16_t ledStreamRestarts;
+extern volatile uint16_t ledStreamDropped;
+#endif
+
+#if LED_DRIVER == LED_DRIVER_USART_SPI
+// Number of times the USART ran dry in the middle of a frame because an interrupt held off
+// the feed.  A short gap is harmless; one longer than the latch time splits the frame.
+extern volatile uint16_t ledSpiUnderruns;
+#endif
+
+#if (LED_DRIVER == LED_DRIVER_USART_SPI) || (LED_DRIVER == LED_DRIVER_APA102)
+// True while a frame is still going out.  updateLEDs() returns before that.
+extern bool ledSpiBusy (void);
+#endif
+
+#if LED_DRIVER == LED_DRIVER_BITBANG_WINDOWED
+// Number of times a frame was started again because an interrupt held the line low for
+// longer than LED_LATCH_GUARD_US, and number of frames given up after too many restarts.
+extern volatile uint16_t ledFrameRestarts;
+extern volatile uint16_t ledFramesDropped;
+#endif
+
+#if LED_DRIVER == LED_DRIVER_PARALLEL
+// Sends one array of color bytes to each strip in LED_PARALLEL_STRIPS at the same time.
+// numBytes is the number of bytes in each array, and is the same for every strip.
+extern void updateLEDsParallel (uint8_t *strips[], uint16_t numBytes);
+#endif
+
+#endif // _LED_DRIVER_H_
@@ -0,0 +1,50 @@
+/*
+	Pixel formats.  The animation code always works on LED_CHANNELS values per LED, at the
+	offsets LED_RED, LED_GRN, LED_BLU and (for RGBW strips) LED_WHT, whatever the strip wants.
+	The drivers pick the bytes of each LED out in the order LED_WIRE_0, LED_WIRE_1, ... as they
+	send them, so changing LED_FORMAT in config.h does not touch the animation code.  This file
+	is included by the drivers written in assembly too.
+*/
+#ifndef _LED_FORMAT_H_
+#define _LED_FORMAT_H_
+
+// Offsets of the colors of one LED in the LED array
+#define LED_RED				0
+#define LED_GRN				1
+#define LED_BLU				2
+#define LED_WHT				3			// Only with LED_FORMAT_RGBW
+
+// Order of the color bytes of one LED on the wire
+#if LED_FORMAT == LED_FORMAT_GRB
+#define LED_WIRE_0			LED_GRN
+#define LED_WIRE_1			LED_RED
+#define LED_WIRE_2			LED_BLU
+#elif LED_FORMAT == LED_FORMAT_RGB
+#define LED_WIRE_0			LED_RED
+#define LED_WIRE_1			LED_GRN
+#define LED_WIRE_2			LED_BLU
+#elif LED_FORMAT == LED_FORMAT_RGBW
+#define LED_WIRE_0			LED_GRN
+#define LED_WIRE_1			LED_RED
+#define LED_WIRE_2			LED_BLU
+#define LED_WIRE_3			LED_WHT
+#elif LED_FORMAT == LED_FORMAT_APA102
+#define LED_WIRE_0			LED_BLU		// After the brightness byte that starts each LED
+#define LED_WIRE_1			LED_GRN
+#define LED_WIRE_2			LED_RED
+#else
+#error "LEDFormat.h: unknown LED_FORMAT"
+#endif
+
+#if LED_CHANNELS == 4
+#define LED_WIRE_ORDER		{ LED_WIRE_0, LED_WIRE_1, LED_WIRE_2, LED_WIRE_3 }
+#else
+#define LED_WIRE_ORDER		{ LED_WIRE_0, LED_WIRE_1, LED_WIRE_2 }
+#endif
+
+// APA102 strips are clocked and only the APA102 driver can send them
+#if (LED_FORMAT == LED_FORMAT_APA102) != (LED_DRIVER == LED_DRIVER_APA102)
+#error "LEDFormat.h: LED_FORMAT_APA102 and LED_DRIVER_APA102 go together"
+#endif
+
+#endif // _LED_FORMAT_H_
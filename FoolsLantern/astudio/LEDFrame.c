@@ -0,0 +1,332 @@
+/*
+ * \file LEDFrame.c
+ *
+ * \brief Output stage between the animation code and the LED drivers
+ *
+ *	The animation code renders into its own array, the back buffer, and calls ledFrameDone()
+ *	when a frame is finished.  Nothing is sent then.  ledFrameTick() runs from one timer at
+ *	LED_FRAME_INTERVAL and, if a frame has been finished since the last tick, copies it into
+ *	frameFront[] and sends that.  So however many times the animation and command handlers
+ *	change the LEDs in between, the strip is written at most once a tick, at a steady time,
+ *	and a tick with nothing new costs nothing.  The back buffer is copied rather than swapped
+ *	because the animations work on the last frame in place, so they need it kept there.
+ *
+ *	A finished frame that is the same as the one already showing is not sent either, which
+ *	covers the animations that call ledFrameDone() every step after they have stopped changing
+ *	(THROB at full brightness, for one).  Comparing the frame costs a few cycles a byte against
+ *	30 uS per LED with interrupts off to send it.  So that a glitch on the strip does not stay
+ *	there for good, the frame is sent again after LED_REFRESH_TICKS ticks without a change.
+ *	The front buffer starts out dark, which the strip may not be, so the first frame is always
+ *	sent, even one that is all dark like the one appInit() clears the LEDs with.
+ *	ledFramesEmitted and ledFramesSkipped count the ticks that did and did not send; the
+ *	skipped count times the frame time (see LEDBench.c) is the interrupt-off time saved.
+ *
+ *	The copy into the front buffer starts at the LED set by ledFrameSetHead(), wrapping around
+ *	to the start of the back buffer, so the strip can be turned by any number of LEDs either
+ *	way without the animation code moving anything.  The copy is made on every new frame
+ *	anyway, so the rotation costs nothing on top of it, however long the strip.
+ *
+ *	With LED_STREAM_LEDS, an effect that works each LED out from its position can hand
+ *	ledFrameStream() its pixel function instead of finishing a frame in the back buffer.  The
+ *	tick then has LEDStream.c draw the LEDs one at a time as they go out, for LED_STREAM_LEDS
+ *	LEDs, and nothing is copied, compared or dithered.
+ *
+ *	With LED_FADE, ledFrameFade() starts a crossfade.  What the strip is showing is kept in
+ *	frameFrom[], and for the number of ticks asked for each tick mixes the front buffer over it
+ *	into frameMix[] and sends that, a little more of the front buffer each time, whether or not
+ *	a new frame came in.  The effect carries on running while it fades in, so the blend is from
+ *	the old frame to the moving new effect, not to a still.  Fading costs two more buffers of
+ *	LED_FRAME_BYTES values and a multiply per byte on the ticks that fade.  A streamed frame
+ *	is gone once it is sent, so a fade away from a streaming effect is a cut.  Without
+ *	LED_FADE the buffers are left out and every fade is a cut.
+ *
+ *	Without LED_DITHER the front buffer is already bytes and goes straight to updateLEDs().
+ *
+ *	With LED_DITHER each value is 8.8 fixed point.  Every tick gamma corrects and scales
+ *	the value while it is still 16 bits (see LEDGamma.h), adds the fraction left over from the
+ *	last tick, sends the top 8 bits and keeps the bottom 8 for next time.  Over a number of
+ *	ticks the average output is the full 16-bit value, so fades keep moving smoothly at the
+ *	dark end, where one 8-bit step is a large change in brightness.  This sends the front
+ *	buffer again on every tick, even when the animation is not changing anything, so no ticks
+ *	are skipped.
+ *
+ *	With LED_BENCHMARK, the cycles spent in each tick that sent something are left in
+ *	ledBenchOutputCycles, and the cycles spent dithering in ledBenchDitherCycles.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "config.h"
+#include "LEDDriver.h"
+#include "LEDGamma.h"
+#include "LEDFrame.h"
+#include "LEDBench.h"
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+static ledval_t frameFront[LED_FRAME_BYTES];		// The frame being shown
+static ledval_t *frameBack;							// The finished frame waiting for the next tick
+static bool frameReady = false;
+static uint16_t frameHead = 0;						// LED of the back buffer sent first
+static bool frameShown = false;						// The front buffer holds a finished frame
+#ifdef LED_FADE
+static ledval_t frameFrom[LED_FRAME_BYTES];			// What the strip showed when the fade started
+static ledval_t frameMix[LED_FRAME_BYTES];			// Sent while fading
+static uint16_t frameFadeTicks = 0;					// Length of the fade, 0 when not fading
+static uint16_t frameFadeTick;						// Ticks of it sent so far
+#endif
+#if (LED_REFRESH_TICKS > 0) && !defined(LED_DITHER)
+static uint16_t frameUnchanged = 0;					// Ticks since the strip was last sent
+#endif
+#ifdef LED_STREAM_LEDS
+static LEDPixel_t framePixel = NULL;				// Set while a streaming effect is running
+static bool frameStreamed = false;					// The strip is showing a streamed frame
+#endif
+#ifdef LED_DITHER
+static uint8_t frameOut[LED_FRAME_BYTES];			// Bytes sent to the driver
+static uint8_t frameResidual[LED_FRAME_BYTES];		// Fraction carried over to the next refresh
+#endif
+
+volatile uint32_t ledFramesEmitted;
+volatile uint32_t ledFramesSkipped;
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+void ledFrameDone(ledval_t back[])
+{
+	frameBack = back;
+	frameReady = true;
+#ifdef LED_STREAM_LEDS
+	framePixel = NULL;
+#endif
+}
+
+bool ledFramePending(void)
+{
+	return frameReady;
+}
+
+#ifdef LED_STREAM_LEDS
+void ledFrameStream(LEDPixel_t pixel)
+{
+	framePixel = pixel;
+	frameReady = true;
+}
+#endif
+
+void ledFrameSetHead(uint16_t led)
+{
+	frameHead = led % NUM_LEDS;
+}
+
+uint16_t ledFrameHead(void)
+{
+	return frameHead;
+}
+
+void ledFrameFade(uint16_t ticks)
+{
+#ifndef LED_FADE
+	(void)ticks;
+#else
+#ifdef LED_STREAM_LEDS
+	if (framePixel != NULL)
+		ticks = 0;
+#endif
+	if (ticks == 0)
+	{
+		frameFadeTicks = 0;
+		return;
+	}
+	memcpy(frameFrom, (frameFadeTicks != 0) ? frameMix : frameFront, sizeof(frameFrom));
+	frameFadeTicks = ticks;
+	frameFadeTick = 0;
+#endif
+}
+
+/*****************************************************************************
+	The buffer to send this tick.  While fading, that is the front buffer mixed over
+	frameFrom[] by how far into the fade this tick is, and the last tick of the fade is all
+	front buffer.
+*****************************************************************************/
+#ifndef LED_FADE
+static inline ledval_t *frameSource(void)
+{
+	return frameFront;
+}
+#else
+static ledval_t *frameSource(void)
+{
+	uint16_t weight;
+	uint16_t inverse;
+	const ledval_t *from = frameFrom;
+	const ledval_t *front = frameFront;
+	ledval_t *mix = frameMix;
+
+	if (frameFadeTicks == 0)
+		return frameFront;
+	weight = ((uint32_t)++frameFadeTick << 8) / frameFadeTicks;	// 1 to 256
+	inverse = 256 - weight;
+	for (ledindex_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr++)
+	{
+#ifdef LED_DITHER
+		*mix++ = ((uint32_t)*from++ * inverse + (uint32_t)*front++ * weight) >> 8;
+#else
+		*mix++ = ((uint16_t)*from++ * inverse + (uint16_t)*front++ * weight) >> 8;
+#endif
+	}
+	if (frameFadeTick >= frameFadeTicks)
+		frameFadeTicks = 0;
+	return frameMix;
+}
+#endif // LED_FADE
+
+/*****************************************************************************
+	Copy the finished frame into the front buffer, from the head LED to the end of the back
+	buffer and then around from its start
+*****************************************************************************/
+static void frameCopy(void)
+{
+	uint16_t head = frameHead * LED_CHANNELS;
+	uint16_t tail = LED_FRAME_BYTES - head;
+
+	memcpy(frameFront, &frameBack[head], tail * sizeof(ledval_t));
+	memcpy(&frameFront[tail], frameBack, head * sizeof(ledval_t));
+}
+
+#ifndef LED_DITHER
+/*****************************************************************************
+	True if the front buffer already holds the finished frame, rotated the same way
+*****************************************************************************/
+static bool frameSame(void)
+{
+	uint16_t head = frameHead * LED_CHANNELS;
+	uint16_t tail = LED_FRAME_BYTES - head;
+
+	return (memcmp(frameFront, &frameBack[head], tail * sizeof(ledval_t)) == 0) &&
+		(memcmp(&frameFront[tail], frameBack, head * sizeof(ledval_t)) == 0);
+}
+#endif
+
+#ifdef LED_DITHER
+/*****************************************************************************
+	Dither a buffer of LED_FRAME_BYTES values down to bytes and send it
+*****************************************************************************/
+static void ledRefresh(const ledval_t frame[])
+{
+	uint16_t value;
+#ifdef LED_BENCHMARK
+	uint32_t start = benchTicks();
+#endif
+
+	for (ledindex_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr++)
+	{
+		value = frame[LED_ptr];
+		if (value > LED_VALUE_MAX)
+			value = LED_VALUE_MAX;
+#ifdef LED_GAMMA
+		value = ledScale16(value);
+#endif
+// This cannot overflow, as value is at most 0xFF00
+		value += frameResidual[LED_ptr];
+		frameOut[LED_ptr] = value >> 8;
+		frameResidual[LED_ptr] = value & 0xFF;
+	}
+#ifdef LED_BENCHMARK
+	ledBenchDitherCycles = BENCH_TICKS_TO_CYCLES(benchTicks() - start);
+#endif
+	updateLEDs(frameOut, LED_FRAME_BYTES);
+}
+#endif // LED_DITHER
+
+/*****************************************************************************
+	Take in the finished frame, if there is one, and send the front buffer
+*****************************************************************************/
+void ledFrameTick(void)
+{
+#ifdef LED_BENCHMARK
+	uint32_t start = benchTicks();
+#endif
+
+#ifdef LED_STREAM_LEDS
+// A streamed frame is only drawn as it goes out, so there is nothing to compare or keep
+	if (framePixel != NULL)
+	{
+		if (!frameReady)
+		{
+			ledFramesSkipped++;
+			return;
+		}
+		frameReady = false;
+		frameStreamed = true;
+		ledFramesEmitted++;
+		updateLEDsStream(framePixel, LED_STREAM_LEDS);
+#ifdef LED_BENCHMARK
+		ledBenchOutputCycles = BENCH_TICKS_TO_CYCLES(benchTicks() - start);
+#endif
+		return;
+	}
+#endif
+#ifdef LED_DITHER
+// The dither has to keep going whether or not there is a new frame
+	if (frameReady)
+	{
+		frameCopy();
+		frameReady = false;
+		frameShown = true;
+	}
+	if (!frameShown)
+	{
+		ledFramesSkipped++;
+		return;
+	}
+	ledFramesEmitted++;
+	ledRefresh(frameSource());
+#else
+	bool changed = false;
+
+	if (frameReady)
+	{
+		frameReady = false;
+		if (!frameShown || !frameSame())
+		{
+			frameCopy();
+			frameShown = true;
+			changed = true;
+		}
+	}
+#ifdef LED_STREAM_LEDS
+// The front buffer may match, but the strip is still showing the last streamed frame
+	if (frameStreamed)
+	{
+		frameStreamed = false;
+		changed = true;
+	}
+#endif
+#if LED_REFRESH_TICKS > 0
+	if (++frameUnchanged >= LED_REFRESH_TICKS)
+		changed = true;
+#endif
+#ifdef LED_FADE
+	if (frameFadeTicks != 0)
+		changed = true;
+#endif
+	if (!changed)
+	{
+		ledFramesSkipped++;
+		return;
+	}
+#if LED_REFRESH_TICKS > 0
+	frameUnchanged = 0;
+#endif
+	ledFramesEmitted++;
+	updateLEDs(frameSource(), LED_FRAME_BYTES);
+#endif
+#ifdef LED_BENCHMARK
+	ledBenchOutputCycles = BENCH_TICKS_TO_CYCLES(benchTicks() - start);
+#endif
+}
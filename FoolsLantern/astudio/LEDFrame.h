@@ -0,0 +1,73 @@
+/*
+	Output stage between the animation code and the LED drivers.  The animation code works on an
+	array of ledval_t, LED_CHANNELS per LED at the offsets in LEDFormat.h, which is the back
+	buffer.  When a frame is finished it calls ledFrameDone(), and the next ledFrameTick() takes
+	it into the front buffer and sends it, so the LEDs are only ever sent from one place, once
+	per tick.  With LED_DITHER in config.h the values are 8.8 fixed point, and the fraction is
+	turned into brightness steps finer than one count by temporal dithering, which needs every
+	tick to send the frame again.  ledFrameFade() has the ticks crossfade into the frames that
+	follow instead of cutting to them.
+*/
+#ifndef _LED_FRAME_H_
+#define _LED_FRAME_H_
+
+#include <stdint.h>
+#include "LEDFormat.h"
+#include "LEDDriver.h"
+
+#ifdef LED_DITHER
+typedef uint16_t ledval_t;
+#define LED_FRAC_BITS		8
+#else
+typedef uint8_t ledval_t;
+#define LED_FRAC_BITS		0
+#endif
+
+// Index into an array of LED_FRAME_BYTES values.  8 bits when the array is no longer than
+// that, so the loops over it count in one register rather than two.
+#if LED_FRAME_BYTES <= 255
+typedef uint8_t ledindex_t;
+#else
+typedef uint16_t ledindex_t;
+#endif
+
+// Working value of an 8-bit color intensity
+#define LED_VALUE(v)		((ledval_t)(v) << LED_FRAC_BITS)
+#define LED_VALUE_MAX		LED_VALUE(255)
+
+// Marks the back buffer of LED_FRAME_BYTES values as a finished frame.  It is copied when the
+// next tick sends it, so the animation code can carry on working on it in place.
+extern void ledFrameDone (ledval_t back[]);
+
+// True from ledFrameDone() until a tick has taken the frame.  An effect that is about to
+// change the back buffer in a way that must not hide the frame before it can wait for this.
+extern bool ledFramePending (void);
+
+#ifdef LED_STREAM_LEDS
+// Marks a frame drawn by a pixel function as finished, see LEDStream.c.  The next tick sends
+// LED_STREAM_LEDS LEDs by calling it for each one, until ledFrameDone() is called again.
+extern void ledFrameStream (LEDPixel_t pixel);
+#endif
+
+// Turns the strip by sending the back buffer from this LED on, wrapping around to its start, 0
+// for no rotation.  The back buffer is not touched, and the change shows with the next finished
+// frame.
+extern void ledFrameSetHead (uint16_t led);
+
+// The LED set by ledFrameSetHead()
+extern uint16_t ledFrameHead (void);
+
+// Blends from what the strip is showing now to the frames finished after it, over the next
+// ticks ticks, rather than cutting to them.  0 cuts, and a call during a fade starts a new one
+// from wherever that one had got to.  Without LED_FADE in config.h it always cuts.
+extern void ledFrameFade (uint16_t ticks);
+
+// Sends the last finished frame, if it is different from the one showing.  Call every
+// LED_FRAME_INTERVAL from a single timer.
+extern void ledFrameTick (void);
+
+// Frame ticks that sent the LEDs, and ticks that had nothing new to send
+extern volatile uint32_t ledFramesEmitted;
+extern volatile uint32_t ledFramesSkipped;
+
+#endif // _LED_FRAME_H_
@@ -0,0 +1,86 @@
+/*
+ * \file LEDGamma.c
+ *
+ * \brief Gamma correction table and master brightness for the LED drivers
+ *
+ *	The effects work on linear values, but the LEDs look much brighter than that at the low end.
+ *	When LED_GAMMA is defined in config.h, every driver looks each byte up in ledGamma[] and then
+ *	scales it by ledBrightness + 1 as it goes out, so the LED array itself is never changed.
+ *	The table is gamma 2.2, rounded, and is aligned to 256 bytes so that the assembly driver
+ *	only has to load the low byte of the address.  With LED_DITHER the correction is done on
+ *	the 8.8 values in LEDFrame.c instead, using ledGamma16[], and the drivers send bytes as is.
+ */
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "config.h"
+#include "LEDGamma.h"
+
+#ifdef LED_GAMMA
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+const uint8_t ledGamma[256] PROGMEM __attribute__((aligned(256))) =
+{
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+	  1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+	  3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+	  6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+	 12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+	 20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+	 30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+	 42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+	 56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+	 73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+	 91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+	113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+	137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+	163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+	192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+	223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255
+};
+
+#ifdef LED_DITHER
+// The same curve with 8 fraction bits, for LEDFrame.c to correct 8.8 values before dithering
+const uint16_t ledGamma16[256] PROGMEM =
+{
+	    0,     0,     2,     4,     7,    11,    17,    24,
+	   32,    42,    53,    65,    78,    94,   110,   128,
+	  148,   169,   191,   216,   241,   269,   298,   328,
+	  360,   394,   430,   467,   506,   547,   589,   633,
+	  679,   726,   776,   827,   880,   934,   991,  1049,
+	 1109,  1171,  1235,  1300,  1368,  1437,  1508,  1581,
+	 1656,  1733,  1812,  1893,  1975,  2060,  2146,  2235,
+	 2325,  2417,  2512,  2608,  2706,  2806,  2908,  3013,
+	 3119,  3227,  3337,  3450,  3564,  3680,  3798,  3919,
+	 4041,  4166,  4292,  4421,  4552,  4685,  4819,  4956,
+	 5096,  5237,  5380,  5525,  5673,  5823,  5974,  6128,
+	 6284,  6442,  6603,  6765,  6930,  7097,  7266,  7437,
+	 7610,  7786,  7963,  8143,  8325,  8509,  8696,  8885,
+	 9075,  9268,  9464,  9661,  9861, 10063, 10267, 10474,
+	10682, 10893, 11107, 11322, 11540, 11760, 11982, 12207,
+	12433, 12663, 12894, 13128, 13363, 13602, 13842, 14085,
+	14330, 14578, 14827, 15080, 15334, 15591, 15850, 16111,
+	16375, 16641, 16909, 17180, 17453, 17729, 18006, 18287,
+	18569, 18854, 19141, 19431, 19723, 20017, 20314, 20613,
+	20915, 21218, 21525, 21833, 22144, 22458, 22774, 23092,
+	23413, 23736, 24062, 24390, 24720, 25053, 25388, 25726,
+	26066, 26408, 26753, 27101, 27451, 27803, 28158, 28515,
+	28875, 29237, 29602, 29969, 30338, 30710, 31085, 31462,
+	31841, 32223, 32608, 32995, 33384, 33776, 34170, 34567,
+	34967, 35369, 35773, 36180, 36589, 37001, 37416, 37833,
+	38252, 38674, 39099, 39526, 39956, 40388, 40823, 41260,
+	41700, 42142, 42587, 43034, 43484, 43937, 44392, 44849,
+	45310, 45772, 46238, 46706, 47176, 47649, 48125, 48603,
+	49084, 49567, 50053, 50542, 51033, 51526, 52023, 52522,
+	53023, 53527, 54034, 54543, 55055, 55570, 56087, 56607,
+	57129, 57654, 58182, 58712, 59245, 59780, 60318, 60859,
+	61402, 61948, 62497, 63048, 63602, 64159, 64718, 65280
+};
+#endif
+
+volatile uint8_t ledBrightness = 255;
+
+#endif // LED_GAMMA
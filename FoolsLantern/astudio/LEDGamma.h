@@ -0,0 +1,51 @@
+/*
+	Gamma correction and master brightness applied by the LED drivers as the bytes go out.
+	ledBrightness dims the whole strip without touching the LED array, 255 is full brightness.
+*/
+#ifndef _LED_GAMMA_H_
+#define _LED_GAMMA_H_
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#ifdef LED_GAMMA
+
+extern const uint8_t ledGamma[256] PROGMEM;
+extern volatile uint8_t ledBrightness;
+
+#ifdef LED_DITHER
+extern const uint16_t ledGamma16[256] PROGMEM;
+
+// Corrected and scaled 8.8 value, for LEDFrame.c.  The value must not be above 0xFF00.
+static inline uint16_t ledScale16(uint16_t value)
+{
+	uint8_t index = value >> 8;
+	uint16_t corrected = pgm_read_word(&ledGamma16[index]);
+
+// Interpolate between table entries on the fraction bits
+	if (index < 255)
+		corrected += ((uint32_t)(pgm_read_word(&ledGamma16[index + 1]) - corrected) * (value & 0xFF)) >> 8;
+	return ((uint32_t)corrected * ledBrightness + corrected) >> 8;
+}
+#endif // LED_DITHER
+
+#endif // LED_GAMMA
+
+// The drivers correct and scale each byte as it goes out, unless LEDFrame.c has already done it
+#if defined(LED_GAMMA) && !defined(LED_DITHER)
+
+// Corrected and scaled value of one color byte, for the drivers written in C
+static inline uint8_t ledScale(uint8_t value)
+{
+	uint8_t corrected = pgm_read_byte(&ledGamma[value]);
+
+	return ((uint16_t)corrected * ledBrightness + corrected) >> 8;
+}
+
+#else
+
+#define ledScale(value)		(value)
+
+#endif
+
+#endif // _LED_GAMMA_H_
@@ -0,0 +1,124 @@
+/*
+ * \file LEDParallel.c
+ *
+ * \brief WS2812 output to up to 8 strips at once from one port
+ *
+ *	The strips listed in LED_PARALLEL_STRIPS in config.h are sent in one pass, so a frame for
+ *	8 strips of N LEDs takes as long as one strip of N LEDs.  The color bytes are first turned
+ *	into slices: slice 8*i+b holds bit 7-b of byte i of every strip, each in the bit position of
+ *	that strip's pin.  ledParallelOut() in LEDParallel.s then writes one slice per WS2812 bit.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <avr/io.h>
+#include "config.h"
+#include "LEDDriver.h"
+#include "LEDGamma.h"
+#include "LEDFormat.h"
+#include "LEDParallel.h"
+
+#if LED_DRIVER == LED_DRIVER_PARALLEL
+
+#if (NUM_LEDS % LED_PARALLEL_COUNT) != 0
+#error "LEDParallel.c: NUM_LEDS has to divide evenly between the strips"
+#endif
+
+/*****************************************************************************
+ Preprocessor definitions
+*****************************************************************************/
+
+#define LED_STRIP_BYTES			(LED_FRAME_BYTES/LED_PARALLEL_COUNT)	// Color bytes on each strip
+#define LED_SLICE_SIZE			(LED_STRIP_BYTES*8)				// One slice for each bit
+
+#define LED_PARALLEL_PIN_MASK(name, port, bit)	(1 << (bit)),
+#define LED_PARALLEL_PIN_INIT(name, port, bit)	HAL_GPIO_##name##_out(); HAL_GPIO_##name##_clr();
+
+/*****************************************************************************
+		Prototypes
+*****************************************************************************/
+
+extern void ledParallelOut (uint8_t slices[], uint16_t numSlices);
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+static const uint8_t wireOrder[LED_CHANNELS] = LED_WIRE_ORDER;
+static const uint8_t stripMask[LED_PARALLEL_COUNT] = { LED_PARALLEL_STRIPS(LED_PARALLEL_PIN_MASK) };
+static uint8_t slices[LED_SLICE_SIZE + 1];			// The output loop fetches one slice ahead
+static bool parallelReady = false;
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+static void ledParallelInit(void)
+{
+#ifdef LED_PARALLEL_NO_JTAG
+	uint8_t mcucr = MCUCR | (1 << JTD);
+
+// JTD has to be written twice within four cycles to take effect
+	MCUCR = mcucr;
+	MCUCR = mcucr;
+#endif
+	LED_PARALLEL_STRIPS(LED_PARALLEL_PIN_INIT)
+	parallelReady = true;
+}
+
+/*****************************************************************************
+	Send one array of color bytes to each strip.  numBytes is the number of bytes in each
+	array, LED_CHANNELS per LED as for updateLEDs(), and every strip gets the same number.
+*****************************************************************************/
+void updateLEDsParallel(uint8_t *strips[], uint16_t numBytes)
+{
+	uint8_t *slicePtr = slices;
+	uint8_t value;
+	uint8_t mask;
+
+	if (numBytes > LED_STRIP_BYTES)
+		numBytes = LED_STRIP_BYTES;
+	numBytes -= numBytes % LED_CHANNELS;			// Whole LEDs only
+	if (numBytes == 0)
+		return;
+	if (!parallelReady)
+		ledParallelInit();
+	memset(slices, 0, numBytes*8);
+// Transpose: bit 7-b of each strip's byte, after gamma correction, goes to its pin position in
+// slice b.  The bytes of each LED are taken in wire order.
+	for (uint16_t LED_ptr=0;LED_ptr<numBytes;LED_ptr+=LED_CHANNELS)
+	{
+		for (uint8_t channel=0;channel<LED_CHANNELS;channel++)
+		{
+			for (uint8_t strip=0;strip<LED_PARALLEL_COUNT;strip++)
+			{
+				value = ledScale(strips[strip][LED_ptr + wireOrder[channel]]);
+				mask = stripMask[strip];
+				for (uint8_t bit=0;value!=0;bit++)		// Stop once the remaining bits are all zero
+				{
+					if (value & 0x80)
+						slicePtr[bit] |= mask;
+					value <<= 1;
+				}
+			}
+			slicePtr += 8;
+		}
+	}
+	ledParallelOut(slices, numBytes*8);
+}
+
+/*****************************************************************************
+	Split the array of color bytes evenly between the strips, in the order they are listed
+	in config.h, and send them all at once.
+*****************************************************************************/
+void updateLEDs(uint8_t colorArray[], uint16_t numLEDs)
+{
+	uint8_t *strips[LED_PARALLEL_COUNT];
+	uint16_t stripBytes = numLEDs / LED_CHANNELS / LED_PARALLEL_COUNT * LED_CHANNELS;
+
+	for (uint8_t strip=0;strip<LED_PARALLEL_COUNT;strip++)
+		strips[strip] = &colorArray[strip*stripBytes];
+	updateLEDsParallel(strips, stripBytes);
+}
+
+#endif // LED_DRIVER_PARALLEL
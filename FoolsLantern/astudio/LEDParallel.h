@@ -0,0 +1,24 @@
+/*
+	Values worked out from the LED_PARALLEL_STRIPS list in config.h for the parallel LED driver.
+	This is included by LEDParallel.s as well as LEDParallel.c, so it only holds macros.
+*/
+#ifndef _LED_PARALLEL_H_
+#define _LED_PARALLEL_H_
+
+#define LED_PARALLEL_ONE(name, port, bit)		+1
+#define LED_PARALLEL_BIT(name, port, bit)		| (1 << (bit))
+
+// Number of strips, and the pins they use on LED_PARALLEL_PORT
+#define LED_PARALLEL_COUNT		(0 LED_PARALLEL_STRIPS(LED_PARALLEL_ONE))
+#define LED_PARALLEL_MASK		(0 LED_PARALLEL_STRIPS(LED_PARALLEL_BIT))
+
+// Register of LED_PARALLEL_PORT, e.g. LED_PARALLEL_REG(PORT) is PORTF
+#define LED_PARALLEL_CAT(reg, port)		reg ## port
+#define LED_PARALLEL_XCAT(reg, port)	LED_PARALLEL_CAT(reg, port)
+#define LED_PARALLEL_REG(reg)			LED_PARALLEL_XCAT(reg, LED_PARALLEL_PORT)
+
+#if (LED_PARALLEL_COUNT < 1) || (LED_PARALLEL_COUNT > 8)
+#error "LEDParallel.h: LED_PARALLEL_STRIPS must list 1 to 8 pins"
+#endif
+
+#endif // _LED_PARALLEL_H_
@@ -0,0 +1,85 @@
+#include <avr/io.h>
+#include "config.h"
+
+#if LED_DRIVER == LED_DRIVER_PARALLEL
+#include "WS2812Timing.h"
+#include "LEDParallel.h"
+.global ledParallelOut
+
+//Use r18-r27, r30, r31
+//Don't use r2-r17, r28, r29
+/*	This function sends up to 8 WS2812 strips at once, one strip per pin of LED_PARALLEL_PORT.
+	It receives a pointer to an array of slices, each of which holds one bit for every strip in
+	that strip's pin position (see LEDParallel.c, which builds them), along with the number of
+	slices.  Every pin in LED_PARALLEL_MASK goes high at the start of each bit, the pins whose bit
+	is a zero go low after T0H, and the rest go low after T1H.  The other pins on the port are
+	left as they were when the function was called.  Interrupts are turned off while it runs and
+	the status register is restored upon exit.
+
+	The address of the array of slices is expected in registers 24 and 25.  The number of slices
+	in the form of a two-byte integer is expected in registers 22 and 23, and must not be zero.
+	The array must have one byte more than the number of slices, as the loop fetches one ahead.
+
+	The delays are worked out from F_CPU in the same way as in LED2812.s.  One bit, counted from
+	the OUT that sets the pins high:
+		T0H   = W1 + 1 cycles
+		T1H   = W1 + W2 + 2 cycles
+		TBIT  = W1 + W2 + W3 + 10 cycles
+	At 8 and 12 MHz the loop needs more cycles than a 1250 nS bit, so W3 is zero and the bit
+	comes out at 1750 and 1500 nS, which is still inside the bit period the LEDs accept.
+*/
+
+#define LEDP_PORT			_SFR_IO_ADDR(LED_PARALLEL_REG(PORT))
+
+// Padding cycles in each part of the bit (see the timing above)
+#define LEDP_W1				(NS_TO_CYCLES(WS2812_T0H)-1)
+#define LEDP_W2				(NS_TO_CYCLES(WS2812_T1H)-NS_TO_CYCLES(WS2812_T0H)-1)
+#if (NS_TO_CYCLES(WS2812_TBIT) - LEDP_W1 - LEDP_W2 - 10) > 0
+#define LEDP_W3				(NS_TO_CYCLES(WS2812_TBIT)-LEDP_W1-LEDP_W2-10)
+#else
+#define LEDP_W3				0
+#endif
+
+// Fail the build rather than send bits the LEDs will misread
+#if (LEDP_W1 < 0) || (LEDP_W2 < 0)
+#error "LEDParallel.s: F_CPU is too slow for the parallel WS2812 bit loop"
+#endif
+#if (CYCLES_TO_NS(LEDP_W1 + 1) < WS2812_T0H_MIN) || (CYCLES_TO_NS(LEDP_W1 + 1) > WS2812_T0H_MAX)
+#error "LEDParallel.s: T0H cannot be met at this F_CPU"
+#endif
+#if (CYCLES_TO_NS(LEDP_W1 + LEDP_W2 + 2) < WS2812_T1H_MIN) || (CYCLES_TO_NS(LEDP_W1 + LEDP_W2 + 2) > WS2812_T1H_MAX)
+#error "LEDParallel.s: T1H cannot be met at this F_CPU"
+#endif
+#if (CYCLES_TO_NS(LEDP_W1 + LEDP_W2 + LEDP_W3 + 10) < WS2812_TBIT_MIN) || (CYCLES_TO_NS(LEDP_W1 + LEDP_W2 + LEDP_W3 + 10) > WS2812_TBIT_MAX)
+#error "LEDParallel.s: the bit period cannot be met at this F_CPU"
+#endif
+
+ledParallelOut:		// Preamble to  load parameters, save state, and prevent interrupts
+			movw	r26, r24				// Get the pointer to the slices into X
+			movw	r24, r22				// Load the slice counter
+			in 		r18, 0x3F				// Save status register
+			cli								// Turn off interrupts
+			in		r22, LEDP_PORT			// Output levels for low and high that leave the
+			andi	r22, ~LED_PARALLEL_MASK & 0xFF	// other pins on the port as they are
+			mov		r21, r22
+			ori		r21, LED_PARALLEL_MASK
+			ld		r19, X+					// Get the first slice and merge in the other pins
+			or		r19, r22
+/**************************************************************************************/
+/* Loop over the slices, one bit of every strip each time around */
+BitLoop:
+			out		LEDP_PORT, r21			//1 All strips high
+			delay	LEDP_W1
+			out		LEDP_PORT, r19			//1 Strips sending a 0 go low after T0H
+			delay	LEDP_W2
+			out		LEDP_PORT, r22			//1 The rest go low after T1H
+			ld		r19, X+					//2 Get the next slice
+			or		r19, r22				//1 and merge in the other pins
+			sbiw	r24, 1					//2 Decrement slice counter
+			delay	LEDP_W3
+			brne	BitLoop					//1/2 Send next bit
+/**************************************************************************************/
+			out 	0x3F, r18				// Restore the status register (and interrupt flag)
+			ret
+
+#endif // LED_DRIVER_PARALLEL
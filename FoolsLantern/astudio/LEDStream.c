@@ -0,0 +1,128 @@
+/*
+ * \file LEDStream.c
+ *
+ * \brief WS2812 output drawn one LED at a time as it goes out, with no frame buffer
+ *
+ *	Built when LED_STREAM_LEDS is defined in config.h, with either bit-banged driver.  Instead
+ *	of an array, updateLEDsStream() takes a function that works out the color of one LED from
+ *	its position.  Each LED is drawn into a buffer of LED_CHANNELS bytes and sent through
+ *	ledSendBytes() in LED2812.s before the next one is drawn, so the strip can be as long as
+ *	LED_STREAM_LEDS whatever NUM_LEDS is, and takes no RAM for it.
+ *
+ *	The line rests low while the next LED is drawn, the same as between the windows of
+ *	LEDWindowed.c, and interrupts are let in there too.  Everything in the gap, the drawing
+ *	and any interrupts, has to fit in LED_LATCH_GUARD_US or the strip latches part way along:
+ *	about 600 cycles at 16 MHz, less the 40 or so the loop takes.  The gap is timed on Timer5
+ *	and a frame that runs over is started again after a full latch time, up to
+ *	LED_WINDOW_RESTARTS times, then dropped.  That is only safe because the pixel function
+ *	gives the same color for the same LED every time it is called during a frame, which is
+ *	what makes an effect a streaming one.  ledStreamRestarts and ledStreamDropped count them;
+ *	a pixel function that is simply too slow shows up as every frame being dropped.
+ *
+ *	The bytes are gamma corrected and scaled by LED2812.s as usual.  With LED_DITHER there is
+ *	no 8.8 value to dither, so the correction is done here on the whole byte instead.
+ */
+
+#include <stdbool.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+#include "config.h"
+#include "LEDDriver.h"
+#include "LEDGamma.h"
+
+#ifdef LED_STREAM_LEDS
+
+#if (LED_DRIVER != LED_DRIVER_BITBANG) && (LED_DRIVER != LED_DRIVER_BITBANG_WINDOWED)
+#error "LEDStream.c: LED_STREAM_LEDS needs LED_DRIVER_BITBANG or LED_DRIVER_BITBANG_WINDOWED"
+#endif
+
+/*****************************************************************************
+ Preprocessor definitions
+*****************************************************************************/
+
+#define LED_US_TO_TICKS(us)		((us) * (F_CPU / 1000000UL) / 8)
+#define LED_GUARD_TICKS			LED_US_TO_TICKS(LED_LATCH_GUARD_US)
+#define LED_LATCH_TICKS			LED_US_TO_TICKS(60)		// Low time that is sure to latch the strip
+
+/*****************************************************************************
+		Prototypes
+*****************************************************************************/
+
+extern void ledSendBytes (uint8_t colorArray[], uint16_t numBytes);
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+static bool streamReady = false;
+
+volatile uint16_t ledStreamRestarts;
+volatile uint16_t ledStreamDropped;
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+/*****************************************************************************
+	Timer5 counts at F_CPU/8 in normal mode, the same as for LEDWindowed.c and LEDBench.c
+*****************************************************************************/
+static void ledStreamInit(void)
+{
+	TCCR5A = 0;
+	TCCR5B = (1 << CS51);
+	streamReady = true;
+}
+
+/*****************************************************************************
+	Draw and send numLEDs LEDs, one at a time.  Note that this is a number of LEDs, not bytes.
+*****************************************************************************/
+void updateLEDsStream(LEDPixel_t pixel, uint16_t numLEDs)
+{
+	uint8_t LED[LED_CHANNELS];
+	uint16_t LED_ptr = 0;
+	uint16_t lastEnd = 0;
+	uint8_t restarts = 0;
+	bool late;
+
+	if (!streamReady)
+		ledStreamInit();
+	while (LED_ptr < numLEDs)
+	{
+		pixel(LED_ptr, LED);
+#if defined(LED_GAMMA) && defined(LED_DITHER)
+		for (uint8_t channel=0;channel<LED_CHANNELS;channel++)
+			LED[channel] = ledScale16((uint16_t)LED[channel] << 8) >> 8;
+#endif
+		late = false;
+// Interrupts stay off from the gap check to the end of the LED, so nothing gets in between
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			if ((LED_ptr != 0) && ((uint16_t)(TCNT5 - lastEnd) > LED_GUARD_TICKS))
+			{
+				late = true;
+			} else
+			{
+				ledSendBytes(LED, LED_CHANNELS);
+				lastEnd = TCNT5;
+			}
+		}
+		if (late)
+		{
+// Make sure the strip has latched what it got, then start the frame again
+			ledStreamRestarts++;
+			while ((uint16_t)(TCNT5 - lastEnd) < LED_LATCH_TICKS)
+				;
+			if (++restarts > LED_WINDOW_RESTARTS)
+			{
+				ledStreamDropped++;
+				return;
+			}
+			LED_ptr = 0;
+		} else
+		{
+			LED_ptr++;
+		}
+	}
+}
+
+#endif // LED_STREAM_LEDS
@@ -0,0 +1,186 @@
+/*
+ * \file LEDUsartSpi.c
+ *
+ * \brief WS2812 output through USART1 running in master SPI mode
+ *
+ *	Each WS2812 data bit is sent as a 4-bit SPI symbol, 1000 for a zero and 1100 for a one, so the
+ *	high times come from the SPI clock instead of from counted instructions with interrupts off.
+ *	A 3-bit symbol would need a third less RAM, but no whole divider at 12 or 16 MHz gives it a
+ *	bit period inside WS2812_TBIT_MIN/MAX with both high times in their limits.
+ *	updateLEDs() encodes the frame into spiFrame[] and returns right away.  The data register
+ *	empty interrupt then feeds the USART one byte at a time and the transmit complete interrupt
+ *	marks the end of the frame, so the radio and timer interrupts keep running the whole time.
+ *
+ *	Every symbol ends low, so the line rests low if the feed is late and after the last byte,
+ *	which is what the strip needs to latch.  The strip data input must be wired to TXD1 (PD3);
+ *	XCK1 (PD5) carries the SPI clock and has to be left as an output.
+ */
+
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+#include "config.h"
+#include "LEDDriver.h"
+#include "LEDGamma.h"
+#include "LEDFormat.h"
+#include "WS2812Timing.h"
+
+#if LED_DRIVER == LED_DRIVER_USART_SPI
+
+#if defined(HAL_ENABLE_UART) && (HAL_UART_CHANNEL == 1)
+#error "LEDUsartSpi.c: USART1 is already used by the HAL UART"
+#endif
+
+/*****************************************************************************
+ Preprocessor definitions
+*****************************************************************************/
+
+// In master SPI mode the bit rate is F_CPU / (2 * (UBRR + 1)).  Four SPI bits make one WS2812
+// bit, so a zero is high for one SPI bit and a one is high for two.
+#if F_CPU == 12000000
+#define LED_SPI_UBRR		1			// 3.0 MHz: 333 nS / 667 nS high, 1.33 uS per bit
+#elif F_CPU == 16000000
+#define LED_SPI_UBRR		2			// 2.67 MHz: 375 nS / 750 nS high, 1.5 uS per bit
+#elif F_CPU == 20000000
+#define LED_SPI_UBRR		3			// 2.5 MHz: 400 nS / 800 nS high, 1.6 uS per bit
+#else
+#error "LEDUsartSpi.c: no SPI bit rate fits the WS2812 timing at this F_CPU, use LED_DRIVER_BITBANG"
+#endif
+
+#define LED_SPI_BIT_NS		CYCLES_TO_NS(2 * (LED_SPI_UBRR + 1))	// One SPI bit
+#define LED_SPI_SYMBOL_BITS	4					// SPI bits per WS2812 bit
+
+#if (LED_SPI_BIT_NS < WS2812_T0H_MIN) || (LED_SPI_BIT_NS > WS2812_T0H_MAX)
+#error "LEDUsartSpi.c: T0H cannot be met at this F_CPU"
+#endif
+#if (2 * LED_SPI_BIT_NS < WS2812_T1H_MIN) || (2 * LED_SPI_BIT_NS > WS2812_T1H_MAX)
+#error "LEDUsartSpi.c: T1H cannot be met at this F_CPU"
+#endif
+#if (LED_SPI_SYMBOL_BITS * LED_SPI_BIT_NS < WS2812_TBIT_MIN) || (LED_SPI_SYMBOL_BITS * LED_SPI_BIT_NS > WS2812_TBIT_MAX)
+#error "LEDUsartSpi.c: the bit period cannot be met at this F_CPU"
+#endif
+
+#define LED_SPI_FRAME_SIZE	(LED_FRAME_BYTES*4)	// Each color byte becomes 4 SPI bytes
+#define LED_LATCH_US		60					// Low time the strip needs to latch (50 uS minimum)
+
+// Encoding of 2 data bits into one SPI byte: every symbol starts high, carries the data bit in
+// the second place and ends with two lows.
+#define SPI_SYMBOLS(n)		(0x88 | (((n) & 2) << 5) | (((n) & 1) << 2))
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+static const uint8_t spiPair[4] PROGMEM =
+{
+	SPI_SYMBOLS(0), SPI_SYMBOLS(1), SPI_SYMBOLS(2), SPI_SYMBOLS(3)
+};
+
+static const uint8_t wireOrder[LED_CHANNELS] = LED_WIRE_ORDER;
+static uint8_t spiFrame[LED_SPI_FRAME_SIZE];
+static uint8_t * volatile spiNext;
+static uint8_t *spiEnd;
+static volatile bool spiBusy = false;
+static bool spiReady = false;
+
+volatile uint16_t ledSpiUnderruns;
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+/*****************************************************************************
+	Set up USART1 as an SPI master, MSB first, mode 0.  The datasheet asks for UBRR to be
+	zero while the transmitter is enabled, and for XCK to be an output before that.
+*****************************************************************************/
+static void ledSpiInit(void)
+{
+	UBRR1 = 0;
+	DDRD |= (1 << PD3) | (1 << PD5);				// TXD1 carries the data, XCK1 the clock
+	UCSR1C = (1 << UMSEL11) | (1 << UMSEL10);
+	UCSR1B = (1 << TXEN1);
+	UBRR1 = LED_SPI_UBRR;
+	spiReady = true;
+}
+
+/*****************************************************************************
+	Encode the array of color bytes and start sending it.  This only waits if the previous
+	frame is still going out, in which case it also waits out the latch time.
+*****************************************************************************/
+void updateLEDs(uint8_t colorArray[], uint16_t numLEDs)
+{
+	uint8_t *spiPtr = spiFrame;
+	uint8_t value;
+
+	if (numLEDs > LED_FRAME_BYTES)
+		numLEDs = LED_FRAME_BYTES;
+	numLEDs -= numLEDs % LED_CHANNELS;				// Whole LEDs only
+	if (numLEDs == 0)
+		return;
+	if (!spiReady)
+		ledSpiInit();
+	if (spiBusy)
+	{
+		while (spiBusy)
+			;
+		_delay_us(LED_LATCH_US);
+	}
+// The bytes of each LED are taken in wire order and gamma corrected, then each is split into
+// four pairs of bits, MSB first, each of which fills one SPI byte
+	for (uint16_t LED_ptr=0;LED_ptr<numLEDs;LED_ptr+=LED_CHANNELS)
+	{
+		for (uint8_t channel=0;channel<LED_CHANNELS;channel++)
+		{
+			value = ledScale(colorArray[LED_ptr + wireOrder[channel]]);
+			*spiPtr++ = pgm_read_byte(&spiPair[value >> 6]);
+			*spiPtr++ = pgm_read_byte(&spiPair[(value >> 4) & 3]);
+			*spiPtr++ = pgm_read_byte(&spiPair[(value >> 2) & 3]);
+			*spiPtr++ = pgm_read_byte(&spiPair[value & 3]);
+		}
+	}
+	spiEnd = spiPtr;
+	spiNext = spiFrame;
+	spiBusy = true;
+	UCSR1B |= (1 << UDRIE1);
+}
+
+/*****************************************************************************
+	True while a frame is still going out
+*****************************************************************************/
+bool ledSpiBusy(void)
+{
+	return spiBusy;
+}
+
+/*****************************************************************************
+	The transmit buffer is free: hand the USART the next byte of the frame.  If the transmit
+	complete flag is already set, the shift register ran dry before we got here.
+*****************************************************************************/
+ISR(USART1_UDRE_vect)
+{
+	if (UCSR1A & (1 << TXC1))
+	{
+		UCSR1A = (1 << TXC1);
+		ledSpiUnderruns++;
+	}
+	UDR1 = *spiNext++;
+	if (spiNext == spiEnd)
+	{
+// Last byte is in the buffer: wait for it to leave the shift register instead
+		UCSR1A = (1 << TXC1);
+		UCSR1B = (UCSR1B & ~(1 << UDRIE1)) | (1 << TXCIE1);
+	}
+}
+
+/*****************************************************************************
+	The last bit of the frame has gone out and the line is resting low
+*****************************************************************************/
+ISR(USART1_TX_vect)
+{
+	UCSR1B &= ~(1 << TXCIE1);
+	spiBusy = false;
+}
+
+#endif // LED_DRIVER_USART_SPI
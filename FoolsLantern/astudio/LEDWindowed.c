@@ -0,0 +1,122 @@
+/*
+ * \file LEDWindowed.c
+ *
+ * \brief Bit-banged WS2812 output that lets interrupts in between LEDs
+ *
+ *	The plain bit-banged driver keeps interrupts off for the whole frame, 30 uS per LED, so the
+ *	timer and radio can be held off for many mS on a long strip.  This driver sends the frame
+ *	LED_WINDOW_LEDS at a time through ledSendBytes() in LED2812.s and turns interrupts back on
+ *	after each piece.  The line rests low in between, which the LEDs take as a long bit, as long
+ *	as it stays well short of the latch time.
+ *
+ *	Timer5 runs free at F_CPU/8 to time each gap.  If an interrupt kept the line low for more
+ *	than LED_LATCH_GUARD_US, the strip may already have latched part of the frame and will take
+ *	the rest as the start of a new one.  The frame is then started again after a full latch time,
+ *	up to LED_WINDOW_RESTARTS times, after which it is dropped and the next one tries again.
+ *
+ *	Worst case interrupt latency: LED_WINDOW_LEDS * 30 uS (40 uS for RGBW) plus about 2 uS for
+ *	the gap check, so 32 uS for the default of one LED, independent of the strip length.
+ */
+
+#include <stdbool.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+#include "config.h"
+#include "LEDDriver.h"
+
+#if LED_DRIVER == LED_DRIVER_BITBANG_WINDOWED
+
+/*****************************************************************************
+ Preprocessor definitions
+*****************************************************************************/
+
+#define LED_WINDOW_BYTES		(LED_WINDOW_LEDS*LED_CHANNELS)	// Always whole LEDs, see LED2812.s
+#define LED_US_TO_TICKS(us)		((us) * (F_CPU / 1000000UL) / 8)
+#define LED_GUARD_TICKS			LED_US_TO_TICKS(LED_LATCH_GUARD_US)
+#define LED_LATCH_TICKS			LED_US_TO_TICKS(60)		// Low time that is sure to latch the strip
+
+#if (LED_WINDOW_LEDS < 1) || (LED_WINDOW_BYTES > 255)
+#error "LEDWindowed.c: LED_WINDOW_LEDS has to be at least 1 and fit in 255 bytes"
+#endif
+
+/*****************************************************************************
+		Prototypes
+*****************************************************************************/
+
+extern void ledSendBytes (uint8_t colorArray[], uint16_t numBytes);
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+static bool windowReady = false;
+
+volatile uint16_t ledFrameRestarts;
+volatile uint16_t ledFramesDropped;
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+/*****************************************************************************
+	Timer5 counts at F_CPU/8 in normal mode.  LEDBench.c sets it up the same way, so the two
+	can be used together.
+*****************************************************************************/
+static void ledWindowInit(void)
+{
+	TCCR5A = 0;
+	TCCR5B = (1 << CS51);
+	windowReady = true;
+}
+
+/*****************************************************************************
+	Send the array of color bytes a window at a time, with interrupts allowed in between
+*****************************************************************************/
+void updateLEDs(uint8_t colorArray[], uint16_t numLEDs)
+{
+	uint16_t LED_ptr = 0;
+	uint16_t lastEnd = 0;
+	uint8_t restarts = 0;
+	uint8_t window;
+	bool late;
+
+	if (!windowReady)
+		ledWindowInit();
+	while (LED_ptr < numLEDs)
+	{
+		window = LED_WINDOW_BYTES;
+		if (numLEDs - LED_ptr < LED_WINDOW_BYTES)
+			window = numLEDs - LED_ptr;
+		late = false;
+// Interrupts stay off from the gap check to the end of the window, so nothing gets in between
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			if ((LED_ptr != 0) && ((uint16_t)(TCNT5 - lastEnd) > LED_GUARD_TICKS))
+			{
+				late = true;
+			} else
+			{
+				ledSendBytes(&colorArray[LED_ptr], window);
+				lastEnd = TCNT5;
+			}
+		}
+		if (late)
+		{
+// Make sure the strip has latched what it got, then start the frame again
+			ledFrameRestarts++;
+			while ((uint16_t)(TCNT5 - lastEnd) < LED_LATCH_TICKS)
+				;
+			if (++restarts > LED_WINDOW_RESTARTS)
+			{
+				ledFramesDropped++;
+				return;
+			}
+			LED_ptr = 0;
+		} else
+		{
+			LED_ptr += window;
+		}
+	}
+}
+
+#endif // LED_DRIVER_BITBANG_WINDOWED
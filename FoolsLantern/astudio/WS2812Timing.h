@@ -0,0 +1,41 @@
+/*
+	WS2812 bit timing shared by the LED drivers written in assembly.  Each driver works out its own
+	padding from these, as the number of instructions in each part of the bit differs, and checks
+	the result against the limits so that a clock that cannot meet them fails the build.
+*/
+#ifndef _WS2812_TIMING_H_
+#define _WS2812_TIMING_H_
+
+// Target bit timing in nS, and the limits that both WS2812 and WS2812B accept
+#define WS2812_T0H			350
+#define WS2812_T1H			800
+#define WS2812_TBIT			1250
+#define WS2812_T0H_MIN		250
+#define WS2812_T0H_MAX		500
+#define WS2812_T1H_MIN		650
+#define WS2812_T1H_MAX		850
+#define WS2812_TBIT_MIN		1200
+#define WS2812_TBIT_MAX		1850
+
+#ifndef F_CPU
+#error "WS2812Timing.h: F_CPU is not defined for the assembler"
+#endif
+
+// Round a time in nS to the nearest number of clock cycles, and back
+// (no spaces, so that the result can be handed to an assembler macro as one argument)
+#define NS_TO_CYCLES(ns)	((F_CPU/1000*(ns)+500000)/1000000)
+#define CYCLES_TO_NS(c)		((c)*1000000/(F_CPU/1000))
+
+#ifdef __ASSEMBLER__
+// Burn a number of cycles, two at a time where possible to save flash
+.macro		delay	cycles
+	.rept	(\cycles) / 2
+			rjmp	.+0						//2
+	.endr
+	.if		(\cycles) % 2
+			nop								//1
+	.endif
+.endm
+#endif // __ASSEMBLER__
+
+#endif // _WS2812_TIMING_H_
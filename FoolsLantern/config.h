@@ -4,7 +4,9 @@
  * \brief This configuration file is used with the FoolsLantern code to set up special flags
  *
  */
+#ifndef __ASSEMBLER__					// The LED drivers written in assembly include this file too
 #include <halGpio.h>
+#endif
 
 #ifndef _CONFIG_H_
 #define _CONFIG_H_
@@ -12,10 +14,56 @@
 // Parameters that affect options in this code:
 
 #define BOARD_VERSION 2			// Indicates which hardware revision to assume
-								// NOTE: There is also a parameter in the LED2812.s file that must be changed
+								// NOTE: The LED drivers pick their output pin from this too
 //#define FIXED_ADDR true			// Determines whether or not to use a fixed network addr, rather than EEPROM
 //#define FIXED_CHAN true			// Determines whether to use a defined channel, or search for best channel
 
+// Selects the driver that sends the LED array out to the strip.  Every driver provides updateLEDs()
+#define LED_DRIVER_BITBANG			0			// LED2812.s, interrupts are off for the whole frame
+#define LED_DRIVER_USART_SPI		1			// LEDUsartSpi.c, USART1 in master SPI mode, interrupt driven
+#define LED_DRIVER_PARALLEL			2			// LEDParallel.c/.s, up to 8 strips on one port in one pass
+#define LED_DRIVER_BITBANG_WINDOWED	3			// LEDWindowed.c + LED2812.s, interrupts can run between LEDs
+#define LED_DRIVER_APA102			4			// LEDApa102.c, clocked APA102 / SK9822 strips on the hardware SPI
+#define LED_DRIVER					LED_DRIVER_BITBANG
+
+// Selects the order and number of the color bytes each LED takes.  The animation code always
+// works in red, green, blue (white) order and the driver reorders them, see LEDFormat.h
+#define LED_FORMAT_GRB				0			// WS2812, WS2812B
+#define LED_FORMAT_RGB				1			// WS2811 and strips that take red first
+#define LED_FORMAT_RGBW				2			// SK6812 RGBW, 4 bytes per LED sent as G, R, B, W
+#define LED_FORMAT_APA102			3			// APA102 / SK9822, only with LED_DRIVER_APA102
+#define LED_FORMAT					LED_FORMAT_GRB
+#define LED_GAMMA							// Gamma correction and ledBrightness in the LED drivers, see LEDGamma.c
+//#define LED_DITHER							// 8.8 LED values with temporal dithering, see LEDFrame.c
+#define LED_FADE							// Crossfades into new commands, two more LED arrays, see LEDFrame.c
+//#define LED_BENCHMARK						// Times the LED output path at start-up, see LEDBench.c
+
+// Settings for LED_DRIVER_BITBANG_WINDOWED.  Interrupts are held off for at most LED_WINDOW_LEDS
+// LEDs at 30 uS each (40 uS for RGBW), whatever the length of the strip.
+#define LED_WINDOW_LEDS				1			// LEDs sent between interrupt windows
+#define LED_LATCH_GUARD_US			40			// Restart the frame if the line was held low longer than this.
+												// The datasheet latch time is 50 uS, but early WS2812 latch sooner
+#define LED_WINDOW_RESTARTS			2			// Restarts allowed before the frame is dropped
+
+// Settings for LED_DRIVER_APA102
+#define LED_APA102_CLOCK_DIV		8			// SPI clock is F_CPU / 2, 4, 8, 16, 32, 64 or 128.
+												// Faster leaves less CPU between the byte interrupts
+
+// Strips driven by effects that work out each LED as it is sent, with no LED array.  These can be
+// much longer than NUM_LEDS, which only sizes the arrays the other effects draw into.  Needs one
+// of the bit-banged drivers and uses the LED_LATCH_GUARD_US and LED_WINDOW_RESTARTS settings.
+//#define LED_STREAM_LEDS				512			// LEDs sent by streaming effects, see LEDStream.c
+
+// Settings for the PARTICLES effect, see FoolsParticles.c
+#define PARTICLE_POOL_SIZE			16			// Most particles alive at once, 11 bytes of RAM each
+
+// Settings for the overlay layers, see FoolsLayers.c
+#define LAYER_COUNT					3			// The base effect and the overlays over it, 2 to 4.  Each overlay
+												// takes two lines of LED_FRAME_BYTES values and an effect's state
+
+// Settings for the effect programs sent over the radio, see FoolsProgram.c
+#define PROGRAM_SIZE				128			// Longest program, at most 253.  Takes twice this in RAM and once in EEPROM
+
 /*****************************************************************************
 *****************************************************************************/
 // Configuration Options
@@ -34,11 +82,14 @@
 #define CHANNEL_SCAN_INTERVAL		2000			// Dwell time on each channel while in local mode
 #define LED_ANIMATION_INTERVAL		62				// Number of mS between changes to the LED patternif not static
 #define ACCELERATION_INTERVAL		1000			// Interval between increments or decrements of animation rate
+#define LED_FRAME_INTERVAL			10				// Number of mS between frame ticks, the most often the LEDs are sent
+#define LED_REFRESH_TICKS			100				// Send an unchanged frame again after this many ticks, 0 for never
+#define LOCAL_SHOW								// With no commands, play the show in FoolsShowData.c rather than the blue throb
 
 #define SYS_SECURITY_MODE                   0
 
 #define NWK_BUFFERS_AMOUNT                  8
-#define NWK_MAX_ENDPOINTS_AMOUNT            4
+#define NWK_MAX_ENDPOINTS_AMOUNT            6		// Endpoints 0 to 5, see FoolsModes.h
 #define NWK_DUPLICATE_REJECTION_TABLE_SIZE  10
 #define NWK_DUPLICATE_REJECTION_TTL         2000	// ms
 #define NWK_ROUTE_TABLE_SIZE                100		// There are expected to be <100 nodes in the mesh
@@ -49,11 +100,30 @@
 //#define NWK_ENABLE_SECURITY						// These flags are used to add in the code for security
 //#define PHY_ENABLE_ENERGY_DETECTION				// and for channel energy detection (to avoid busy channels)
 
+#if LED_DRIVER != LED_DRIVER_USART_SPI				// The USART SPI LED driver owns USART1
 #define HAL_ENABLE_UART
+#endif
 #define HAL_UART_CHANNEL                    1
 #define HAL_UART_RX_FIFO_SIZE               200
 #define HAL_UART_TX_FIFO_SIZE               200
 
+// Strips driven by the parallel LED driver.  All the pins have to be on LED_PARALLEL_PORT.  The
+// LED array is split evenly between them, so strip 0 shows the first NUM_LEDS / (number of strips)
+// LEDs, strip 1 the next, and so on.  Leave out any that are not wired up.
+#define LED_PARALLEL_PORT					F
+#define LED_PARALLEL_STRIPS(PIN) \
+	PIN(lightStrip0, F, 0) \
+	PIN(lightStrip1, F, 1) \
+	PIN(lightStrip2, F, 2) \
+	PIN(lightStrip3, F, 3) \
+	PIN(lightStrip4, F, 4) \
+	PIN(lightStrip5, F, 5) \
+	PIN(lightStrip6, F, 6) \
+	PIN(lightStrip7, F, 7)
+#define LED_PARALLEL_NO_JTAG						// PF4-PF7 are the JTAG pins, so the driver turns JTAG off.
+												// Leave out strips 4-7 and this to keep JTAG debugging
+
+#ifndef __ASSEMBLER__
 #if BOARD_VERSION == 1								//Board version 1 uses port E for debug and LED outputs
 	HAL_GPIO_PIN(hbLED, E, 0)						// The heartbeat flag
 	HAL_GPIO_PIN(statusLED, E, 1)					// General status flag
@@ -63,7 +133,11 @@
 	HAL_GPIO_PIN(hbLED, G, 0)						// This is the LED near the antenna on the board
 	HAL_GPIO_PIN(statusLED, D, 7)					// This is the LED near the power regulator on the board
 	HAL_GPIO_PIN(rcvLED, B, 4)						//
+#if LED_DRIVER == LED_DRIVER_USART_SPI
+	HAL_GPIO_PIN(lightStripData, D, 3)				// TXD1, jumper it to the S-LED connector for the USART driver
+#else
 	HAL_GPIO_PIN(lightStripData, D, 4)				// This pin is brought out to the S-LED connector strip
+#endif
 #else
 													// There's a problem if this is executed
 #endif
@@ -74,6 +148,19 @@
 
 	HAL_GPIO_PIN(syncInput, D, 0)					// For the sync
 
+#if LED_DRIVER == LED_DRIVER_PARALLEL
+	LED_PARALLEL_STRIPS(HAL_GPIO_PIN)				// One output per strip for the parallel driver
+#endif
+#endif // __ASSEMBLER__
+
+// Up to 85 LEDs, or 63 RGBW, keeps LED_FRAME_BYTES to 255 or less, and every loop over the LED
+// array 8-bit, see ledindex_t in LEDFrame.h
 #define NUM_LEDS							16
+#if LED_FORMAT == LED_FORMAT_RGBW
+#define LED_CHANNELS						4					// Color values per LED in the LED array
+#else
+#define LED_CHANNELS						3
+#endif
+#define LED_FRAME_BYTES						(NUM_LEDS*LED_CHANNELS)	// Bytes in the LED array
 
 #endif // _CONFIG_H_
@@ -0,0 +1,185 @@
+/*
+ * \file FoolsEffectsTest.c
+ *
+ * \brief Checks that every effect still sends the same frames, run on a PC by test/Makefile
+ *
+ *	Each subMode is started on the same pattern and stepped EFFECT_TEST_STEPS times, with a frame
+ *	tick after each step, and the bytes of every frame handed to updateLEDs() are hashed.  The
+ *	hashes in effectTestFrames[] were taken from the effects before their loops were changed to
+ *	count with ledindex_t and walk local pointers, so a change that is only meant to make the
+ *	effects faster has to leave them all the same.  A change that is meant to alter what an
+ *	effect draws has to take the hashes again, which the test prints when one differs.
+ *	The tests after that check single effects against what their parameters should do.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "config.h"
+#include "FoolsModes.h"
+#include "FoolsEffects.h"
+
+/*****************************************************************************
+ Preprocessor definitions
+*****************************************************************************/
+
+#define CHECK(cond)					do { if (!(cond)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); testFailures++; } } while (0)
+
+#define EFFECT_TEST_STEPS			100			// Steps of each effect
+#define EFFECT_TEST_MODES			(PROGRAM + 1)
+#define EFFECT_TEST_FUSE_MAX		320			// FIRECRACKER_FUSE_MAX in FoolsEffects.c
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+uint8_t averageRSSI;
+
+// Hash of the frames of each subMode, with config.h as it is checked in, with and without LED_DITHER.
+// testFirstFrame() runs first, so with LED_DITHER the dark frame it sent is sent again on every
+// tick of STATIC, which finishes no frames of its own.
+static const uint32_t effectTestFrames[EFFECT_TEST_MODES] =
+{
+#ifdef LED_DITHER
+	0x2786ACC5,		// STATIC
+	0x1932010C,		// ROTATE
+	0x306AAD05,		// FLASH
+	0x9D6BF646,		// RANDOM
+	0xEFEC5630,		// THROB
+	0x17068BD3,		// FIRECRACKER
+	0xCEBABBDD,		// ORBITALS
+	0x2786ACC5,		// ONESHOT
+	0xCF98C262,		// PARTICLES
+	0x5E106B97,		// BREATHE
+	0x82B4A960,		// RAINBOW
+	0xD9AF1DEC,		// FIRE
+	0x4603DB79,		// PLASMA
+	0x10C16E95,		// WATER
+	0xFD01D05E,		// PROGRAM
+#else
+	0xC655FF85,		// STATIC
+	0x71A8F575,		// ROTATE
+	0x51047965,		// FLASH
+	0x26CACC45,		// RANDOM
+	0x861954D1,		// THROB
+	0x9814C2E8,		// FIRECRACKER
+	0xF696BF75,		// ORBITALS
+	0xC655FF85,		// ONESHOT
+	0x4CF67319,		// PARTICLES
+	0x6EDD9656,		// BREATHE
+	0x51C12669,		// RAINBOW
+	0x9A2FAA19,		// FIRE
+	0xD149BA93,		// PLASMA
+	0xA1635226,		// WATER
+	0xA90346B5,		// PROGRAM
+#endif
+};
+
+static uint32_t testHash;
+static bool testLit;								// updateLEDs() sent a byte that was not 0
+static int testFailures = 0;
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+// FNV-1a over the bytes of each frame the effects send.  numLEDs is the number of bytes.
+void updateLEDs(uint8_t colorArray[], uint16_t numLEDs)
+{
+	for (uint16_t byte=0;byte<numLEDs;byte++)
+	{
+		testHash ^= colorArray[byte];
+		testHash *= 16777619;
+		if (colorArray[byte] != 0)
+			testLit = true;
+	}
+}
+
+// Puts the test pattern in place and starts an effect on it
+static void testStart(uint8_t mode)
+{
+	for (uint16_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr++)
+	{
+		LEDpattern[LED_ptr] = LED_VALUE((LED_ptr * 37) & 0xFF);
+		LEDarray[LED_ptr] = LEDpattern[LED_ptr];
+	}
+	testHash = 2166136261;
+	effectSetInterval(LED_ANIMATION_INTERVAL);
+	effectSelect(mode);
+}
+
+// Steps the running effect, with a frame tick after each step
+static void testSteps(uint16_t steps)
+{
+	for (uint16_t step=0;step<steps;step++)
+	{
+		effectStep();
+		ledFrameTick();
+	}
+}
+
+static void testFrames(void)
+{
+	for (uint8_t mode=0;mode<EFFECT_TEST_MODES;mode++)
+	{
+		testStart(mode);
+		testSteps(EFFECT_TEST_STEPS);
+		if (testHash != effectTestFrames[mode])
+		{
+			printf("subMode %u sent different frames, hash 0x%08lX\n", mode, (unsigned long)testHash);
+			testFailures++;
+		}
+	}
+}
+
+// The first frame goes out even when it is all dark, as the front buffer starts, because the
+// strip may be showing anything at power up.  This has to run before any other frame is sent.
+static void testFirstFrame(void)
+{
+	for (uint16_t LED_ptr=0;LED_ptr<LED_FRAME_BYTES;LED_ptr++)
+		LEDarray[LED_ptr] = 0;
+	ledFrameDone(LEDarray);
+	ledFrameTick();
+	CHECK(ledFramesEmitted == 1);
+}
+
+// A fuse longer than the limit, like the 8000 an old controller leaves from THROB, burns
+// for the limit instead, so the burst still comes
+static void testFuse(void)
+{
+	testStart(FIRECRACKER);
+	effectParam(100);
+	CHECK(effectState->firecracker.fuseTicks == 100);
+	effectParam(8000);
+	CHECK(effectState->firecracker.fuseTicks == EFFECT_TEST_FUSE_MAX);
+	testSteps(EFFECT_TEST_FUSE_MAX - 1);
+	CHECK(effectState->firecracker.phase == 0);		// Still burning
+	testSteps(1);
+	CHECK(effectState->firecracker.phase != 0);		// Bang
+}
+
+// The command finishes the ONESHOT pulse and the first step comes before the next tick.  The
+// pulse still has to reach the strip, and be cleared after that.
+static void testOneshot(void)
+{
+	testStart(ONESHOT);
+	ledFrameDone(LEDarray);
+	effectStep();
+	testLit = false;
+	ledFrameTick();
+	CHECK(testLit);
+	testSteps(2);
+	testLit = false;
+	testSteps(LED_REFRESH_TICKS);
+	CHECK(!testLit);
+}
+
+int main(void)
+{
+	averageRSSI = 150;
+	testFirstFrame();
+	testFrames();
+	testFuse();
+	testOneshot();
+	printf("FoolsEffectsTest: %d failed\n", testFailures);
+	return (testFailures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,277 @@
+/*
+ * \file FoolsProgramTest.c
+ *
+ * \brief Tests of the program loader and interpreter, run on a PC by test/Makefile
+ *
+ *	The programs are sent in LED_Program_t chunks through programReceive(), as they come over
+ *	the radio, and the frame code leaves its results in the registers of a ProgramState_t.
+ *	Built with the address and undefined behaviour sanitizers, so the fuzzing at the end
+ *	catches any program that reads or writes outside the interpreter's own memory.
+ *	int is 32 bits on a PC, so these check the values the arithmetic wraps round to, which
+ *	the AVR, with 16-bit int, has to give too.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include "config.h"
+#include "FoolsModes.h"
+#include "FoolsProgram.h"
+
+/*****************************************************************************
+ Preprocessor definitions
+*****************************************************************************/
+
+#define CHECK(cond)					do { if (!(cond)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); testFailures++; } } while (0)
+
+#define W(v)						((v) & 0xFF), (((v) >> 8) & 0xFF)
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+static int testFailures = 0;
+static uint8_t testId = 0;
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+// Sends a program in chunks of chunkSize bytes, and returns what the last chunk gave
+static bool testSend(const uint8_t code[], uint8_t length, uint8_t pixelEntry, uint8_t chunkSize, uint8_t save)
+{
+	LED_Program_t chunk;
+	uint16_t checksum = 0;
+	uint8_t offset = 0;
+	bool done = false;
+
+	for (uint8_t i=0;i<length;i++)
+		checksum += code[i];
+	testId++;
+	while (offset < length)
+	{
+		uint8_t bytes = (length - offset < chunkSize) ? length - offset : chunkSize;
+
+		chunk.id = testId;
+		chunk.length = length;
+		chunk.pixelEntry = pixelEntry;
+		chunk.offset = offset;
+		chunk.save = save;
+		chunk.checksum = checksum;
+		memcpy(chunk.code, &code[offset], bytes);
+		done = programReceive(&chunk, offsetof(LED_Program_t, code) + bytes);
+		offset += bytes;
+	}
+	return done;
+}
+
+// Runs the frame code of a fresh program once
+static void testFrame(ProgramState_t *state)
+{
+	memset(state, 0, sizeof(ProgramState_t));
+	programStart(state);
+	programRunFrame(state);
+}
+
+static void testArithmetic(void)
+{
+	static const uint8_t code[] =
+	{
+		PROG_PUSHW, W(0x7FFF), PROG_PUSH, 1, PROG_ADD, PROG_STORE, 0,
+		PROG_PUSHW, W(300), PROG_PUSHW, W(300), PROG_MUL, PROG_STORE, 1,
+		PROG_PUSHW, W(0x8000), PROG_PUSH, 1, PROG_SUB, PROG_STORE, 2,
+		PROG_PUSHW, W(-300), PROG_PUSHW, W(300), PROG_MUL, PROG_STORE, 3,
+		PROG_PUSHW, W(0x8000), PROG_PUSHW, W(0xFFFF), PROG_MUL, PROG_STORE, 4,
+		PROG_END,
+		PROG_END
+	};
+	ProgramState_t state;
+	uint16_t faults = programFaults;
+
+	CHECK(testSend(code, sizeof(code), sizeof(code) - 1, PROGRAM_CHUNK_SIZE, 0));
+	testFrame(&state);
+	CHECK(state.reg[0] == -32768);			// 32767 + 1
+	CHECK(state.reg[1] == 24464);			// 90000 - 65536
+	CHECK(state.reg[2] == 32767);			// -32768 - 1
+	CHECK(state.reg[3] == -24464);			// -90000 + 65536
+	CHECK(state.reg[4] == -32768);			// -32768 * -1
+	CHECK(programFaults == faults);
+}
+
+static void testStack(void)
+{
+	static const uint8_t code[] =
+	{
+		PROG_PUSH, 1, PROG_PUSH, 2, PROG_OVER, PROG_STORE, 0, PROG_STORE, 1, PROG_STORE, 2,
+		PROG_PUSH, 3, PROG_PUSH, 4, PROG_SWAP, PROG_STORE, 3, PROG_STORE, 4,
+		PROG_PUSH, 5, PROG_DUP, PROG_ADD, PROG_STORE, 5,
+		PROG_END,
+		PROG_END
+	};
+	ProgramState_t state;
+
+	CHECK(testSend(code, sizeof(code), sizeof(code) - 1, PROGRAM_CHUNK_SIZE, 0));
+	testFrame(&state);
+	CHECK(state.reg[0] == 1);
+	CHECK(state.reg[1] == 2);
+	CHECK(state.reg[2] == 1);
+	CHECK(state.reg[3] == 3);
+	CHECK(state.reg[4] == 4);
+	CHECK(state.reg[5] == 10);
+}
+
+// The program only changes when all of it has come, in order, with the right checksum
+static void testReceive(void)
+{
+	static const uint8_t code[PROGRAM_CHUNK_SIZE + 10] =
+	{
+		PROG_PUSH, 42, PROG_STORE, 0,
+		[PROGRAM_CHUNK_SIZE + 8] = PROG_END,
+		[PROGRAM_CHUNK_SIZE + 9] = PROG_END
+	};
+	LED_Program_t chunk;
+	ProgramState_t state;
+
+	CHECK(testSend(code, sizeof(code), sizeof(code) - 1, PROGRAM_CHUNK_SIZE, 0));
+	testFrame(&state);
+	CHECK(state.reg[0] == 42);
+
+// The same program again is not taken twice
+	testId--;
+	CHECK(!testSend(code, sizeof(code), sizeof(code) - 1, PROGRAM_CHUNK_SIZE, 0));
+
+// Only the second chunk of a new program
+	memset(&chunk, 0, sizeof(chunk));
+	chunk.id = ++testId;
+	chunk.length = sizeof(code);
+	chunk.offset = PROGRAM_CHUNK_SIZE;
+	CHECK(!programReceive(&chunk, offsetof(LED_Program_t, code) + 10));
+
+// A wrong checksum
+	chunk.length = 2;
+	chunk.offset = 0;
+	chunk.pixelEntry = 1;
+	chunk.checksum = 1;
+	chunk.code[0] = PROG_END;
+	chunk.code[1] = PROG_END;
+	CHECK(!programReceive(&chunk, offsetof(LED_Program_t, code) + 2));
+
+// A chunk too short to hold any code
+	CHECK(!programReceive(&chunk, offsetof(LED_Program_t, code)));
+
+	testFrame(&state);
+	CHECK(state.reg[0] == 42);
+}
+
+// A loop that never ends is stopped, and counted
+static void testSteps(void)
+{
+	static const uint8_t code[] =
+	{
+		PROG_JMP, (uint8_t)-2,
+		PROG_END
+	};
+	ProgramState_t state;
+	uint16_t faults = programFaults;
+
+	CHECK(testSend(code, sizeof(code), sizeof(code) - 1, PROGRAM_CHUNK_SIZE, 0));
+	testFrame(&state);
+	CHECK(programFaults == faults + 1);
+}
+
+// The pixel code cannot STORE or RAND, so an LED comes out the same each time it is drawn
+static void testPixelCode(void)
+{
+	static const uint8_t code[] =
+	{
+		PROG_PUSH, 5, PROG_STORE, 0,
+		PROG_END,
+		PROG_PUSH, 200, PROG_PUSH, 0, PROG_PUSH, 0, PROG_RGB,
+		PROG_LOAD, 0, PROG_PUSH, 1, PROG_ADD, PROG_STORE, 0,
+		PROG_END,
+		PROG_RAND, PROG_PUSH, 0, PROG_PUSH, 0, PROG_RGB,
+		PROG_END
+	};
+	static const ledval_t pattern[LED_CHANNELS];
+	uint8_t pixel[LED_CHANNELS];
+	ProgramState_t state;
+	uint16_t faults = programFaults;
+
+	CHECK(testSend(code, sizeof(code), 5, PROGRAM_CHUNK_SIZE, 0));
+	testFrame(&state);
+	programRunPixel(&state, 0, pattern, pixel);
+	CHECK(pixel[LED_RED] == 200);
+	CHECK(state.reg[0] == 5);
+	CHECK(programFaults == faults + 1);
+
+	CHECK(testSend(code, sizeof(code), 20, PROGRAM_CHUNK_SIZE, 0));
+	testFrame(&state);
+	programRunPixel(&state, 0, pattern, pixel);
+	CHECK(pixel[LED_RED] == 0);
+	CHECK(programFaults == faults + 2);
+}
+
+// A program sent with save set comes back after a restart
+static void testSave(void)
+{
+	static const uint8_t saved[] =
+	{
+		PROG_PUSH, 7, PROG_STORE, 1,
+		PROG_END,
+		PROG_END
+	};
+	static const uint8_t other[] =
+	{
+		PROG_PUSH, 9, PROG_STORE, 1,
+		PROG_END,
+		PROG_END
+	};
+	ProgramState_t state;
+
+	CHECK(testSend(saved, sizeof(saved), sizeof(saved) - 1, 3, 1));
+	for (uint16_t tick=0;tick<PROGRAM_SIZE + 16;tick++)
+		programSaveTick();
+	CHECK(testSend(other, sizeof(other), sizeof(other) - 1, PROGRAM_CHUNK_SIZE, 0));
+	testFrame(&state);
+	CHECK(state.reg[1] == 9);
+	programRestore();
+	testFrame(&state);
+	CHECK(state.reg[1] == 7);
+}
+
+// Random programs, with any bytes and any pixel entry, run every instruction with any operands
+static void testFuzz(void)
+{
+	uint8_t code[PROGRAM_SIZE];
+	ledval_t pattern[LED_CHANNELS];
+	uint8_t pixel[LED_CHANNELS];
+	ProgramState_t state;
+
+	srand(1);
+	for (uint16_t run=0;run<20000;run++)
+	{
+		uint8_t length = 1 + rand() % PROGRAM_SIZE;
+
+		for (uint8_t i=0;i<length;i++)
+			code[i] = rand() % (PROG_OPCODES + 2);
+		for (uint8_t i=0;i<LED_CHANNELS;i++)
+			pattern[i] = rand();
+		testSend(code, length, rand() % (length + 1), PROGRAM_CHUNK_SIZE, 0);
+		testFrame(&state);
+		programRunPixel(&state, rand() % NUM_LEDS, pattern, pixel);
+	}
+}
+
+int main(void)
+{
+	testArithmetic();
+	testStack();
+	testReceive();
+	testSteps();
+	testPixelCode();
+	testSave();
+	testFuzz();
+	printf("FoolsProgramTest: %d failed\n", testFailures);
+	return (testFailures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,24 @@
+/*
+	Stand-in for avr-libc's <avr/eeprom.h> when the effects are built on a PC by test/Makefile.
+	Variables declared EEMEM are ordinary RAM, so a test can read back what was saved, and the
+	EEPROM is always ready.
+*/
+#ifndef _AVR_EEPROM_H_
+#define _AVR_EEPROM_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define EEMEM
+#define eeprom_busy_wait()			do {} while (0)
+#define eeprom_is_ready()			1
+
+static inline uint8_t eeprom_read_byte(const uint8_t *p) { return *p; }
+static inline void eeprom_update_byte(uint8_t *p, uint8_t value) { *p = value; }
+static inline uint16_t eeprom_read_word(const uint16_t *p) { return *p; }
+static inline void eeprom_write_word(uint16_t *p, uint16_t value) { *p = value; }
+static inline void eeprom_update_word(uint16_t *p, uint16_t value) { *p = value; }
+static inline void eeprom_read_block(void *dst, const void *src, size_t n) { memcpy(dst, src, n); }
+static inline void eeprom_update_block(const void *src, void *dst, size_t n) { memcpy(dst, src, n); }
+
+#endif // _AVR_EEPROM_H_
@@ -0,0 +1,18 @@
+/*
+	Stand-in for avr-libc's <avr/pgmspace.h> when the effects are built on a PC by test/Makefile.
+	A PC has one address space, so the tables in flash are ordinary constants.
+*/
+#ifndef _AVR_PGMSPACE_H_
+#define _AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s)						(s)
+#define pgm_read_byte(p)			(*(const uint8_t *)(p))
+#define pgm_read_word(p)			(*(const uint16_t *)(p))
+#define pgm_read_ptr(p)				(*(void * const *)(p))
+#define memcpy_P					memcpy
+
+#endif // _AVR_PGMSPACE_H_
@@ -0,0 +1,14 @@
+/*
+	Stand-in for the LwMesh HAL header when the effects are built on a PC by test/Makefile.
+	config.h declares the lantern's pins with HAL_GPIO_PIN(), which the tests never touch, and
+	counts on it for the standard types, as the real one gives them through sysTypes.h.
+*/
+#ifndef _HAL_GPIO_H_
+#define _HAL_GPIO_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HAL_GPIO_PIN(name, port, bit)
+
+#endif // _HAL_GPIO_H_
@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+"""
+Assembles an effect program for the PROGRAM subMode into the table the controller sends.
+
+	python progc.py ../programs/scanner.prog ../../LanternController/astudio/FoolsProgramData.c
+
+A program has a frame: part, run once each step, and a pixel: part, run for each LED to give
+its color.  The frame part can be left out, and an END is put after it if it has none.  One
+instruction per line, from the list in FoolsProgram.h without the PROG_, and # starts a comment:
+
+	frame:
+		TIME
+		PUSH	3
+		MUL
+		COS
+		STORE	0		# The position of the eye, for the pixel code
+	pixel:
+		LED
+		LOAD	0
+		SUB
+		JZ		lit		# Jumps take a label
+		...
+	lit:
+		...
+
+PUSH, LOAD, STORE, SHR and SHL take a number, PUSHW a 16-bit number, JZ and JMP a label, and
+a label is a name followed by a colon.  STORE and RAND only go in the frame part, as the pixel
+code has to give the same color every time it is run for an LED in a step.  The instructions
+and which of them take a byte or a word are read from FoolsProgram.h, so they stay in step
+with the firmware.
+"""
+
+import os
+import re
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+PROGRAM_H = os.path.join(HERE, "..", "astudio", "FoolsProgram.h")
+CONFIG_H = os.path.join(HERE, "..", "config.h")
+
+JUMPS = ("JZ", "JMP")
+FRAME_ONLY = ("STORE", "RAND")			# The lantern stops pixel code that runs them
+
+
+class ProgramError(Exception):
+	pass
+
+
+def read_opcodes(path):
+	"""Instruction names by opcode, and the bytes of operand each takes"""
+	text = open(path).read()
+	match = re.search(r"enum\s*\{(.*?)\};", text, flags=re.S)
+	if match is None:
+		raise ProgramError("%s: no instruction enum" % path)
+	opcodes = {}
+	operands = {}
+	for line in match.group(1).splitlines():
+		found = re.match(r"\s*PROG_(\w+)\s*,?\s*(//\s*(\w+):)?", line)
+		if found is None or found.group(1) == "OPCODES":
+			continue
+		opcodes[found.group(1)] = len(opcodes)
+		operands[found.group(1)] = {"byte": 1, "word": 2}.get(found.group(3), 0)
+	return opcodes, operands
+
+
+def read_size(path):
+	match = re.search(r"#define\s+PROGRAM_SIZE\s+(\d+)", open(path).read())
+	if match is None:
+		raise ProgramError("%s: no PROGRAM_SIZE" % path)
+	return int(match.group(1))
+
+
+def number(field, low, high):
+	try:
+		value = int(field, 0)
+	except ValueError:
+		raise ProgramError("bad number '%s'" % field)
+	if not low <= value <= high:
+		raise ProgramError("'%s' should be %d to %d" % (field, low, high))
+	return value
+
+
+def assemble(lines, opcodes, operands):
+	"""Bytes of the program, and where the pixel code starts in them"""
+	code = []
+	labels = {}
+	fixups = []
+	pixel = None
+	last = None
+	for line_number, line in enumerate(lines, 1):
+		fields = line.split("#", 1)[0].split()
+		try:
+			if not fields:
+				continue
+			if len(fields) == 1 and fields[0].endswith(":"):
+				label = fields[0][:-1]
+				if label in labels:
+					raise ProgramError("label '%s' is used twice" % label)
+				if label == "frame" and code:
+					raise ProgramError("frame: has to come first")
+				if label == "pixel":
+					# The frame code has to stop before the pixel code.  With none, the pixel
+					# code starts at 0.
+					if code and last != "END":
+						code.append(opcodes["END"])
+						last = "END"
+					pixel = len(code)
+				labels[label] = len(code)
+				continue
+			name = fields[0].upper()
+			if name not in opcodes:
+				raise ProgramError("unknown instruction '%s'" % fields[0])
+			if pixel is not None and name in FRAME_ONLY:
+				raise ProgramError("%s only goes in the frame: part" % name)
+			size = operands[name]
+			if len(fields) != (2 if size else 1):
+				raise ProgramError("%s takes %s" % (name, "one operand" if size else "no operands"))
+			code.append(opcodes[name])
+			last = name
+			if name in JUMPS:
+				fixups.append((len(code), fields[1], line_number))
+				code.append(0)
+			elif size == 1:
+				code.append(number(fields[1], -128 if name == "PUSH" else 0, 255) & 0xFF)
+			elif size == 2:
+				value = number(fields[1], -32768, 65535) & 0xFFFF
+				code += [value & 0xFF, value >> 8]
+		except ProgramError as error:
+			raise ProgramError("line %d: %s" % (line_number, error))
+	if pixel is None:
+		raise ProgramError("the program has no pixel: part")
+	for where, label, line_number in fixups:
+		if label not in labels:
+			raise ProgramError("line %d: no label '%s'" % (line_number, label))
+		offset = labels[label] - (where + 1)
+		if not -128 <= offset <= 127:
+			raise ProgramError("line %d: '%s' is too far to jump to" % (line_number, label))
+		code[where] = offset & 0xFF
+	return code, pixel
+
+
+def write_table(out, code, pixel, source):
+	name = os.path.basename(source)
+	checksum = sum(code) & 0xFFFF
+	out.write("/*\n")
+	out.write(" * \\file FoolsProgramData.c\n")
+	out.write(" *\n")
+	out.write(" * \\brief The effect program the controller sends for PROGRAM, made from %s\n" % name)
+	out.write(" *\n")
+	out.write(" *\tMade by FoolsLantern/tools/progc.py, so edit %s and run it again rather than editing this.\n" % name)
+	out.write(" */\n\n")
+	out.write("#include <stdint.h>\n")
+	out.write("#include <avr/pgmspace.h>\n\n")
+	out.write("const uint8_t programCode[] PROGMEM =\n{\n")
+	for start in range(0, len(code), 16):
+		out.write("\t" + ", ".join("0x%02X" % byte for byte in code[start:start+16]))
+		out.write(",\n" if start + 16 < len(code) else "\n")
+	out.write("};\n\n")
+	out.write("const uint8_t programLength = %d;\n" % len(code))
+	out.write("const uint8_t programPixelEntry = %d;\n" % pixel)
+	out.write("const uint16_t programChecksum = 0x%04X;\n" % checksum)
+
+
+def main(argv):
+	if len(argv) != 3:
+		sys.stderr.write("usage: %s program.prog FoolsProgramData.c\n" % argv[0])
+		return 2
+	try:
+		opcodes, operands = read_opcodes(PROGRAM_H)
+		size = read_size(CONFIG_H)
+		with open(argv[1]) as source:
+			code, pixel = assemble(source, opcodes, operands)
+		if len(code) > size:
+			raise ProgramError("%d bytes, longer than PROGRAM_SIZE of %d" % (len(code), size))
+	except (OSError, ProgramError) as error:
+		sys.stderr.write("%s: %s\n" % (argv[1], error))
+		return 1
+	# The sources in the tree all have CRLF line ends
+	with open(argv[2], "w", newline="\r\n") as out:
+		write_table(out, code, pixel, argv[1])
+	print("%s: %d bytes, pixel code from %d" % (argv[2], len(code), pixel))
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main(sys.argv))
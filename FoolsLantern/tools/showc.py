@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""
+Compiles a text show into the keyframe table the lanterns play with no controller.
+
+	python showc.py ../shows/local.show ../astudio/FoolsShowData.c
+
+Each line of a show is one keyframe, and # starts a comment:
+
+	time	effect		param		period	fade	first	[last]
+	0:00	BREATHE		5000		62		3.0		0000C4
+	0:45	ROTATE		1			125		2.0		FF4000	0020FF
+	3:00	END
+
+time		From the start of the show, as m:ss.t or seconds, to a tenth of a second
+effect		A subMode from FoolsModes.h, or END on the last line to go round again
+param		The modeParam.  Numbers and names from FoolsModes.h, joined by | or +
+period		mS between animation steps
+fade		Seconds to crossfade into the keyframe, to a tenth, 0 to cut
+first		Color of the first LED as RRGGBB, and of the rest unless last is given
+last		Color of the last LED, the ones between blend from first to last
+
+The effect and param names are read from FoolsModes.h, so they stay in step with the
+firmware.  See FoolsShow.h for the table.
+"""
+
+import os
+import re
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+MODES_H = os.path.join(HERE, "..", "astudio", "FoolsModes.h")
+
+SHOW_TIME_MS = 100			# As in FoolsShow.h
+TIME_MAX = 0xFFFF
+FADE_MAX = 0xFF
+
+
+class ShowError(Exception):
+	pass
+
+
+def read_modes(path):
+	"""subMode names in order, and every other enum constant and numeric #define by value"""
+	text = open(path).read()
+	text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+	text = re.sub(r"//[^\n]*", "", text)
+	subModes = None
+	names = {}
+	for match in re.finditer(r"enum\s*\{([^}]*)\}\s*(\w*)", text):
+		members = [m.strip() for m in match.group(1).split(",") if m.strip()]
+		value = 0
+		for member in members:
+			if "=" in member:
+				member, expr = [part.strip() for part in member.split("=")]
+				value = int(expr, 0)
+			names[member] = value
+			value += 1
+		if match.group(2) == "subMode":
+			subModes = members
+	for match in re.finditer(r"#define\s+(\w+)\s+(0x[0-9A-Fa-f]+|\d+)\b", text):
+		names[match.group(1)] = int(match.group(2), 0)
+	if subModes is None:
+		raise ShowError("%s: no subMode enum" % path)
+	return subModes, names
+
+
+def tenths(field, what):
+	"""m:ss.t or seconds to tenths of a second"""
+	minutes = 0
+	if ":" in field:
+		minutes, field = field.split(":", 1)
+		minutes = int(minutes)
+	try:
+		value = round((minutes * 60 + float(field)) * 1000 / SHOW_TIME_MS)
+	except ValueError:
+		raise ShowError("bad %s '%s'" % (what, field))
+	if value < 0:
+		raise ShowError("%s '%s' is negative" % (what, field))
+	return value
+
+
+def param(field, names):
+	value = 0
+	for token in re.split(r"[|+]", field):
+		if token in names:
+			number = names[token]
+		else:
+			try:
+				number = int(token, 0)
+			except ValueError:
+				raise ShowError("unknown param '%s'" % token)
+		value = (value + number) if "+" in field else (value | number)
+	if not 0 <= value <= 0xFFFF:
+		raise ShowError("param '%s' does not fit in 16 bits" % field)
+	return value
+
+
+def color(field):
+	if not re.fullmatch(r"[0-9A-Fa-f]{6}", field):
+		raise ShowError("bad color '%s', should be RRGGBB" % field)
+	return tuple(int(field[i:i+2], 16) for i in (0, 2, 4))
+
+
+def compile_show(lines, subModes, names):
+	keys = []
+	ended = False
+	last_time = 0
+	for number, line in enumerate(lines, 1):
+		fields = line.split("#", 1)[0].split()
+		if not fields:
+			continue
+		try:
+			if ended:
+				raise ShowError("keyframe after END")
+			time = tenths(fields[0], "time")
+			if time > TIME_MAX:
+				raise ShowError("time '%s' is past the longest show" % fields[0])
+			if time < last_time:
+				raise ShowError("time '%s' is before the keyframe above" % fields[0])
+			last_time = time
+			if len(fields) == 2 and fields[1] == "END":
+				keys.append((time, "SHOW_END", 0, 0, 0, (0, 0, 0), (0, 0, 0)))
+				ended = True
+				continue
+			if len(fields) not in (6, 7):
+				raise ShowError("expected time effect param period fade first [last]")
+			effect = fields[1]
+			if effect not in subModes:
+				raise ShowError("unknown effect '%s', not a subMode in FoolsModes.h" % effect)
+			period = int(fields[3], 0)
+			if not 1 <= period <= 0xFFFF:
+				raise ShowError("period '%s' should be 1 to 65535 mS" % fields[3])
+			fade = tenths(fields[4], "fade")
+			if fade > FADE_MAX:
+				raise ShowError("fade '%s' is longer than %.1f seconds" % (fields[4], FADE_MAX / 10))
+			first = color(fields[5])
+			last = color(fields[6]) if len(fields) == 7 else first
+			keys.append((time, effect, fade, param(fields[2], names), period, first, last))
+		except ShowError as error:
+			raise ShowError("line %d: %s" % (number, error))
+	if not ended:
+		raise ShowError("the show has no END line")
+	if len(keys) < 2:
+		raise ShowError("the show has no keyframes")
+	return keys
+
+
+def write_table(out, keys, source):
+	name = os.path.basename(source)
+	out.write("/*\n")
+	out.write(" * \\file FoolsShowData.c\n")
+	out.write(" *\n")
+	out.write(" * \\brief The show the lanterns play with no controller, made from %s\n" % name)
+	out.write(" *\n")
+	out.write(" *\tMade by tools/showc.py, so edit %s and run it again rather than editing this.\n" % name)
+	out.write(" */\n\n")
+	out.write("#include \"config.h\"\n")
+	out.write("#include \"FoolsModes.h\"\n")
+	out.write("#include \"FoolsShow.h\"\n\n")
+	out.write("const ShowKey_t showTable[] PROGMEM =\n{\n")
+	out.write("//\t  time\tsubMode\t\t\tfade\tparam\tperiod\tfirst\t\t\t\tlast\n")
+	for time, effect, fade, value, period, first, last in keys:
+		tabs = "\t" * max(1, 4 - (len(effect) + 1) // 4)
+		out.write("\t{ %5d,\t%s,%s%3d,\t0x%04X,\t%5d,\t{0x%02X,0x%02X,0x%02X},\t{0x%02X,0x%02X,0x%02X} },\n"
+			% ((time, effect, tabs, fade, value, period) + first + last))
+	out.write("};\n")
+
+
+def main(argv):
+	if len(argv) != 3:
+		sys.stderr.write("usage: %s show.show FoolsShowData.c\n" % argv[0])
+		return 2
+	try:
+		subModes, names = read_modes(MODES_H)
+		with open(argv[1]) as show:
+			keys = compile_show(show, subModes, names)
+	except (OSError, ShowError) as error:
+		sys.stderr.write("%s: %s\n" % (argv[1], error))
+		return 1
+	# The sources in the tree all have CRLF line ends
+	with open(argv[2], "w", newline="\r\n") as out:
+		write_table(out, keys, argv[1])
+	print("%s: %d keyframes, %d:%04.1f long, %d bytes of flash"
+		% (argv[2], len(keys) - 1, keys[-1][0] // 600, keys[-1][0] % 600 / 10, len(keys) * 14))
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main(sys.argv))
@@ -0,0 +1,96 @@
+/*
+ * \file FoolsColor.c
+ *
+ * \brief HSV to RGB in 8-bit fixed point
+ *
+ *	hueRamp[] is the red of a fully saturated color at each hue: full from magenta through
+ *	red to yellow, down to nothing at green, nothing through cyan and back up from blue.
+ *	Green and blue are the same curve a third and two thirds of the way around, so each
+ *	channel is one table read.  Saturation then lifts the channel towards full and value
+ *	scales it, one 8x8 multiply each, with no floats and no division.
+ *
+ *	With LED_BENCHMARK, hsvBenchmark() times HSV_BENCH_PIXELS conversions and leaves the
+ *	cycles per pixel in hsvBenchCycles, and the number of LEDs that can be converted in a
+ *	60 fps frame, with nothing else to do, in hsvBench60fps.
+ */
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "config.h"
+#include "FoolsColor.h"
+#ifdef LED_BENCHMARK
+#include "LEDBench.h"
+#endif
+
+/*****************************************************************************
+		Variables
+*****************************************************************************/
+
+// 255 * clamp(|hue * 360 / 256 - 180| / 60 - 1, 0, 1), rounded
+static const uint8_t hueRamp[256] PROGMEM =
+{
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 253, 247, 241, 235, 229,
+	223, 217, 211, 205, 199, 193, 187, 181, 175, 169, 163, 157, 151, 145, 139, 133,
+	128, 122, 116, 110, 104,  98,  92,  86,  80,  74,  68,  62,  56,  50,  44,  38,
+	 32,  26,  20,  14,   8,   2,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   2,   8,  14,  20,  26,
+	 32,  38,  44,  50,  56,  62,  68,  74,  80,  86,  92,  98, 104, 110, 116, 122,
+	128, 133, 139, 145, 151, 157, 163, 169, 175, 181, 187, 193, 199, 205, 211, 217,
+	223, 229, 235, 241, 247, 253, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255
+};
+
+#ifdef LED_BENCHMARK
+volatile uint16_t hsvBenchCycles;
+volatile uint16_t hsvBench60fps;
+#endif
+
+/*****************************************************************************
+		Function implementations
+*****************************************************************************/
+
+// One channel: at saturation 0 it is full whatever the hue, then scaled by value
+static inline uint8_t hsvChannel(uint8_t ramp, uint8_t sat, uint8_t val)
+{
+	uint8_t level = 255 - (((uint16_t)(255 - ramp) * (sat + 1)) >> 8);
+
+	return ((uint16_t)level * (val + 1)) >> 8;
+}
+
+void hsvToRgb(uint8_t hue, uint8_t sat, uint8_t val, RgbColor_t *rgb)
+{
+	rgb->red = hsvChannel(pgm_read_byte(&hueRamp[hue]), sat, val);
+	rgb->grn = hsvChannel(pgm_read_byte(&hueRamp[(uint8_t)(hue - HUE_GREEN)]), sat, val);
+	rgb->blu = hsvChannel(pgm_read_byte(&hueRamp[(uint8_t)(hue - HUE_BLUE)]), sat, val);
+}
+
+#ifdef LED_BENCHMARK
+/*****************************************************************************
+	Time HSV_BENCH_PIXELS conversions around the wheel.  The colors go into a volatile so
+	that the conversions are not optimised away.
+*****************************************************************************/
+void hsvBenchmark(void)
+{
+	RgbColor_t rgb;
+	volatile uint8_t sink;
+	uint32_t start;
+
+	benchInit();
+	start = benchTicks();
+	for (uint8_t count=0;count<HSV_BENCH_PIXELS;count++)
+	{
+		hsvToRgb(count * (256 / HSV_BENCH_PIXELS), 255 - count, 255, &rgb);
+		sink = rgb.red;
+	}
+	hsvBenchCycles = BENCH_TICKS_TO_CYCLES(benchTicks() - start) / HSV_BENCH_PIXELS;
+	hsvBench60fps = (hsvBenchCycles != 0) ? (F_CPU / 60) / hsvBenchCycles : 0;
+	(void)sink;
+}
+#endif // LED_BENCHMARK
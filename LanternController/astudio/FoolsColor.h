@@ -0,0 +1,35 @@
+/*
+	Colors given as hue, saturation and value, all 8 bits, turned into red, green and blue.
+	The controller and the lanterns share this file, so keep the copies in
+	LanternController/astudio and FoolsLantern/astudio the same.
+*/
+#ifndef _FOOLS_COLOR_H_
+#define _FOOLS_COLOR_H_
+
+#include <stdint.h>
+
+// Hues 0, 85 and 171 are red, green and blue, and the wheel wraps at 256
+#define HUE_RED						0
+#define HUE_GREEN					85
+#define HUE_BLUE					171
+
+typedef struct RgbColor_t {
+	uint8_t		red;
+	uint8_t		grn;
+	uint8_t		blu;
+} RgbColor_t;
+
+// Fills rgb with the color of a hue at a saturation and value, 0 to 255 each
+extern void hsvToRgb (uint8_t hue, uint8_t sat, uint8_t val, RgbColor_t *rgb);
+
+#ifdef LED_BENCHMARK
+#define HSV_BENCH_PIXELS		64				// Conversions timed by hsvBenchmark()
+
+// CPU cycles per pixel, and the pixels that can be converted in a 60 fps frame, see FoolsColor.c
+extern volatile uint16_t hsvBenchCycles;
+extern volatile uint16_t hsvBench60fps;
+
+extern void hsvBenchmark (void);
+#endif
+
+#endif // _FOOLS_COLOR_H_
@@ -7,21 +7,57 @@ typedef enum transforms_t
 	STATIC, ROTATE, FLASH, RANDOM, THROB, FIRECRACKER, ORBITALS
 } transforms_t;
 */
+#define CMD_NUM_LEDS				16			// LED colors carried in a command.  This is fixed by the message
+												// format, and is repeated along strips that have more LEDs
 typedef struct LED_Command_t {
 	enum		{MODE_GLOBAL, MODE_PEER_TO_PEER, MODE_NOCHANGE} mode;
-	enum		{STATIC, ROTATE, FLASH, RANDOM, THROB, FIRECRACKER, ORBITALS, ONESHOT} subMode;
+	enum		{STATIC, ROTATE, FLASH, RANDOM, THROB, FIRECRACKER, ORBITALS, ONESHOT, PARTICLES, BREATHE, RAINBOW, FIRE, PLASMA, WATER, PROGRAM} subMode;
 //	transforms_t	transform;
-	uint8_t		redIntensity[NUM_LEDS];		// Red value for all LEDs
-	uint8_t		grnIntensity[NUM_LEDS];		// Green value for all LEDs
-	uint8_t		bluIntensity[NUM_LEDS];		// Blue value for all LEDs
+	uint8_t		redIntensity[CMD_NUM_LEDS];	// Red value for all LEDs
+	uint8_t		grnIntensity[CMD_NUM_LEDS];	// Green value for all LEDs
+	uint8_t		bluIntensity[CMD_NUM_LEDS];	// Blue value for all LEDs
 	uint16_t	modeParam;					// extra parameter specific to mode
 	uint32_t	period_mS;					// mS
+	uint16_t	fade_mS;					// mS to crossfade from the last command into this one, 0 to cut
+	uint8_t		layer;						// 0 for the base effect, or an overlay layer over it
+	uint8_t		blend;						// How an overlay goes onto the layers under it, BLEND_NONE takes it off
+	uint8_t		alpha;						// Opacity of a BLEND_ALPHA overlay, 255 is opaque
 } LED_Command_t;
 
+// Styles of PARTICLES, in the low byte of modeParam.  The high byte is the chance out of 256 of a
+// new particle each step, 0 for the default.
+enum		{PARTICLE_SPARKS, PARTICLE_COMETS, PARTICLE_BURSTS};
+
+// FIRE, PLASMA and WATER take the spacing of the LEDs over the noise in the low byte of modeParam,
+// in 256ths of a noise cell, so more is finer, and its speed in the high byte, in 256ths of a
+// cell each step.  0 in either is the effect's default.
+
+// Blends of the overlay layers, in LED_Command_t blend.  Adding saturates at full brightness, and
+// multiplying by a layer uses it as a mask over the layers under it.
+enum		{BLEND_NONE, BLEND_ADD, BLEND_MAX, BLEND_ALPHA, BLEND_MULTIPLY};
+
+// A chunk of an effect program for the PROGRAM subMode, on LEDProg_ENDPOINT.  The chunks of a
+// program go in order from offset 0, and a lantern starts running it when it has them all and
+// the checksum is right.
+#define PROGRAM_CHUNK_SIZE			64			// Most bytes of program in one chunk
+typedef struct LED_Program_t {
+	uint8_t		id;							// Changes with the program, so the chunks of two are not mixed
+	uint8_t		length;						// Bytes in the whole program
+	uint8_t		pixelEntry;					// Where the pixel code starts, the frame code starts at 0
+	uint8_t		offset;						// Where this chunk goes in the program
+	uint8_t		save;						// Not 0 to keep the program in EEPROM for the next power up
+	uint16_t	checksum;					// Sum of the bytes of the whole program
+	uint8_t		code[PROGRAM_CHUNK_SIZE];	// The chunk, as many bytes as the message has room for
+} LED_Program_t;
+
+// Added to the modeParam of RANDOM to twinkle each LED on its own rather than flash the whole strip
+#define RANDOM_TWINKLE				0x8000
+
 // App endpoints
 #define LEDCmd_ENDPOINT				1
 #define SyncCmd_ENDPOINT			2
 #define AddrCheck_ENDPOINT			3
 #define Mote_Addr_ENDPOINT			4
+#define LEDProg_ENDPOINT			5
 
 #define BROADCAST_ADDR				0xFFFF
\ No newline at end of file
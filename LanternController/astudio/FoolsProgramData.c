@@ -0,0 +1,22 @@
+/*
+ * \file FoolsProgramData.c
+ *
+ * \brief The effect program the controller sends for PROGRAM, made from scanner.prog
+ *
+ *	Made by FoolsLantern/tools/progc.py, so edit scanner.prog and run it again rather than editing this.
+ */
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+const uint8_t programCode[] PROGMEM =
+{
+	0x1A, 0x05, 0x15, 0x02, 0x16, 0x03, 0x06, 0x01, 0x03, 0x19, 0x0B, 0x1F, 0x0D, 0x01, 0x18, 0x0B,
+	0x0D, 0x07, 0x04, 0x00, 0x00, 0x17, 0x03, 0x00, 0x0A, 0x05, 0x01, 0x00, 0x07, 0x0A, 0x13, 0x01,
+	0x40, 0x0B, 0x01, 0xFF, 0x07, 0x0A, 0x01, 0x00, 0x13, 0x1C, 0x08, 0x0C, 0x07, 0x1D, 0x08, 0x0C,
+	0x07, 0x1E, 0x0C, 0x21
+};
+
+const uint8_t programLength = 52;
+const uint8_t programPixelEntry = 21;
+const uint16_t programChecksum = 0x035E;
@@ -9,7 +9,9 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
+#include <avr/pgmspace.h>
 #include <avr/eeprom.h>
 #include <util/atomic.h>
 #include "config.h"
@@ -18,6 +20,7 @@
 #include "nwk.h"
 #include "sysTimer.h"
 #include "FoolsModes.h"
+#include "FoolsColor.h"
 
 /*****************************************************************************
  Preprocessor definitions
@@ -57,6 +60,12 @@ static void appSendData(void);
 extern void InitADC (void);
 extern uint8_t GetADC (uint8_t channel);
 
+// The effect program for PROGRAM, from FoolsProgramData.c
+extern const uint8_t programCode[] PROGMEM;
+extern const uint8_t programLength;
+extern const uint8_t programPixelEntry;
+extern const uint16_t programChecksum;
+
 /*****************************************************************************
 		Variables
 *****************************************************************************/
@@ -97,6 +106,7 @@ static uint8_t leftButton;
 static uint8_t rightButton;
 static bool readLeft;
 static uint8_t buttonMode;
+static uint8_t programOffset;			// How much of the program has been sent
 
 static uint16_t mainLoopBlink;
 static uint16_t targetAddr;
@@ -156,6 +166,46 @@ static void appSendData(void)
 	targetAddr = BROADCAST_ADDR;
 }
 
+/*****************************************************************************
+// Sends the next chunk of the program in FoolsProgramData.c to all the lanterns.
+// They only take the chunks in order, so the whole program is sent again from
+// the start whenever programOffset is set back to 0.
+*****************************************************************************/
+static void appSendProgram(void)
+{
+	LED_Program_t *chunk = (LED_Program_t *)appDataReqBuffer;
+	uint8_t bytes;
+
+	if (appDataReqBusy)
+		return;
+
+	bytes = programLength - programOffset;
+	if (bytes > PROGRAM_CHUNK_SIZE)
+		bytes = PROGRAM_CHUNK_SIZE;
+	chunk->id = programChecksum;			// Its low byte, which changes with the program
+	chunk->length = programLength;
+	chunk->pixelEntry = programPixelEntry;
+	chunk->offset = programOffset;
+	chunk->save = 1;						// So the lanterns run it after a power cut too
+	chunk->checksum = programChecksum;
+	memcpy_P(chunk->code, &programCode[programOffset], bytes);
+
+	appDataReq.dstAddr = BROADCAST_ADDR;
+	appDataReq.dstEndpoint = LEDProg_ENDPOINT;
+	appDataReq.srcEndpoint = LEDProg_ENDPOINT;
+	appDataReq.options = NWK_OPT_ENABLE_SECURITY;
+	appDataReq.data = appDataReqBuffer;
+	appDataReq.size = offsetof(LED_Program_t, code) + bytes;
+	appDataReq.confirm = appDataConf;
+	NWK_DataReq(&appDataReq);
+
+	HAL_GPIO_statusLED_toggle();
+  	HAL_GPIO_sendStatusLED_clr();
+
+	programOffset += bytes;
+	appDataReqBusy = true;
+}
+
 /*****************************************************************************
 *****************************************************************************/
 static void pollIOTimerHandler(SYS_Timer_t *timer)
@@ -167,13 +217,15 @@ static void pollIOTimerHandler(SYS_Timer_t *timer)
 		readLeft = false;
 		buttonMode++;
 		shotCounter = 1;
+		programOffset = 0;
 	} else if (rightButton && !readLeft)	// Button is active LOW
 	{
 		readLeft = true;
 		buttonMode++;
 		shotCounter = 1;
+		programOffset = 0;
 	}
-	if (buttonMode > ONESHOT)
+	if (buttonMode > PROGRAM)
 	{
 		buttonMode = STATIC;
 	}
@@ -200,8 +252,16 @@ static void meshHeartbeatTimerHandler(SYS_Timer_t *timer)
 
 static void sendCmdTimerHandler(SYS_Timer_t *timer)
 {
+	RgbColor_t rainbowColor;
+
 	cmdBuffer = appWorkingBuffer;
 	cmdBuffer->mode = MODE_GLOBAL;
+// The lanterns blend into each new command, so the changes are smooth without sending more
+// often.  A resend of the command they are running only keeps them from timing out.
+	cmdBuffer->fade_mS = CMD_FADE_MS;
+	cmdBuffer->layer = 0;					// Every command here is for the base effect
+	cmdBuffer->blend = BLEND_NONE;
+	cmdBuffer->alpha = 0;
 #ifdef FREERUN
 	if (demoCounter < 1)
 	{
@@ -215,7 +275,8 @@ static void sendCmdTimerHandler(SYS_Timer_t *timer)
 #endif
 		cmdBuffer->subMode = ONESHOT;
 		cmdBuffer->period_mS = 255;
-		for (int LED_ptr=0;LED_ptr<NUM_LEDS;LED_ptr++)
+		cmdBuffer->fade_mS = 0;				// A shot has to start sharp
+		for (int LED_ptr=0;LED_ptr<CMD_NUM_LEDS;LED_ptr++)
 		{
 #ifdef FREERUN
 			cmdBuffer->redIntensity[LED_ptr] = 0xFF;				// Green
@@ -241,7 +302,7 @@ static void sendCmdTimerHandler(SYS_Timer_t *timer)
 #endif
 		cmdBuffer->subMode = STATIC;
 		cmdBuffer->period_mS = 255;
-		for (int LED_ptr=0;LED_ptr<NUM_LEDS;LED_ptr++)
+		for (int LED_ptr=0;LED_ptr<CMD_NUM_LEDS;LED_ptr++)
 		{
 #ifdef FREERUN
 			cmdBuffer->redIntensity[LED_ptr] = 0xFF;				// Green
@@ -266,7 +327,8 @@ static void sendCmdTimerHandler(SYS_Timer_t *timer)
 #endif
 		cmdBuffer->subMode = ROTATE;
 		cmdBuffer->period_mS = 62;
-		for (int LED_ptr=0;LED_ptr<NUM_LEDS;LED_ptr++)
+		cmdBuffer->modeParam = 1;			// LEDs to turn each step, negative to turn the other way
+		for (int LED_ptr=0;LED_ptr<CMD_NUM_LEDS;LED_ptr++)
 		{
 #ifdef FREERUN
 			cmdBuffer->redIntensity[LED_ptr] = LED_ptr*16-1;
@@ -306,7 +368,7 @@ static void sendCmdTimerHandler(SYS_Timer_t *timer)
 #endif
 		cmdBuffer->subMode = FLASH;
 		cmdBuffer->period_mS = 250;
-		for (int LED_ptr=0;LED_ptr<NUM_LEDS;LED_ptr++)
+		for (int LED_ptr=0;LED_ptr<CMD_NUM_LEDS;LED_ptr++)
 		{
 #ifdef FREERUN
 			cmdBuffer->redIntensity[LED_ptr] = 0xFF;				// Green
@@ -333,7 +395,7 @@ static void sendCmdTimerHandler(SYS_Timer_t *timer)
 		cmdBuffer->subMode = RANDOM;
 		cmdBuffer->period_mS = 100;
 		cmdBuffer->modeParam = 512;		// This is the probability for how often to flash
-		for (int LED_ptr=0;LED_ptr<NUM_LEDS;LED_ptr++)
+		for (int LED_ptr=0;LED_ptr<CMD_NUM_LEDS;LED_ptr++)
 		{
 #ifdef FREERUN
 			cmdBuffer->redIntensity[LED_ptr] = 0xFF;				// Green
@@ -358,8 +420,8 @@ static void sendCmdTimerHandler(SYS_Timer_t *timer)
 #endif
 		cmdBuffer->subMode = THROB;
 		cmdBuffer->period_mS = 62;
-		cmdBuffer->modeParam = 4;			// The rate at which is throbs
-		for (int LED_ptr=0;LED_ptr<NUM_LEDS;LED_ptr++)
+		cmdBuffer->modeParam = 8000;		// mS for one throb
+		for (int LED_ptr=0;LED_ptr<CMD_NUM_LEDS;LED_ptr++)
 		{
 #ifdef FREERUN
 			cmdBuffer->redIntensity[LED_ptr] = 0xFF;				// Green
@@ -385,7 +447,8 @@ static void sendCmdTimerHandler(SYS_Timer_t *timer)
 #endif
 		cmdBuffer->subMode = FIRECRACKER;
 		cmdBuffer->period_mS = 62;
-		for (int LED_ptr=0;LED_ptr<NUM_LEDS;LED_ptr++)
+		cmdBuffer->modeParam = 0;			// The lanterns' own fuse length
+		for (int LED_ptr=0;LED_ptr<CMD_NUM_LEDS;LED_ptr++)
 		{
 			cmdBuffer->redIntensity[LED_ptr] = 0;				// Green
 			cmdBuffer->grnIntensity[LED_ptr] = 0;				// Red
@@ -405,16 +468,216 @@ static void sendCmdTimerHandler(SYS_Timer_t *timer)
 #endif
 		cmdBuffer->subMode = ORBITALS;
 		cmdBuffer->period_mS = 62;
-		for (int LED_ptr=0;LED_ptr<NUM_LEDS;LED_ptr++)
+		for (int LED_ptr=0;LED_ptr<CMD_NUM_LEDS;LED_ptr++)
 		{
 			cmdBuffer->redIntensity[LED_ptr] = 0;				// Green
 			cmdBuffer->grnIntensity[LED_ptr] = 0;				// Red
 			cmdBuffer->bluIntensity[LED_ptr] = 0;				// Blue
 		}
+#ifdef FREERUN
+	} else if (demoCounter < 45)
+	{
+		if (demoCounter == 40)
+		{
+			shotCounter = 1;
+		}
+#else
+	} else if (buttonMode == PARTICLES)
+	{
+		shotCounter = 2;
+#endif
+		cmdBuffer->subMode = PARTICLES;
+		cmdBuffer->period_mS = 16;
+		cmdBuffer->modeParam = PARTICLE_COMETS;		// Comets in the knob color, at the default rate
+		for (int LED_ptr=0;LED_ptr<CMD_NUM_LEDS;LED_ptr++)
+		{
+#ifdef FREERUN
+			cmdBuffer->redIntensity[LED_ptr] = 0xFF;				// Green
+			cmdBuffer->grnIntensity[LED_ptr] = 0xFF;				// Red
+			cmdBuffer->bluIntensity[LED_ptr] = 0xFF;				// Blue
+#else
+			cmdBuffer->redIntensity[LED_ptr] = redADC;				// Red
+			cmdBuffer->grnIntensity[LED_ptr] = grnADC;				// Green
+			cmdBuffer->bluIntensity[LED_ptr] = bluADC;				// Blue
+#endif
+		}
+#ifdef FREERUN
+	} else if (demoCounter < 50)
+	{
+		if (demoCounter == 45)
+		{
+			shotCounter = 1;
+		}
+#else
+	} else if (buttonMode == BREATHE)
+	{
+		shotCounter = 2;
+#endif
+		cmdBuffer->subMode = BREATHE;
+		cmdBuffer->period_mS = 20;
+		cmdBuffer->modeParam = 5000;		// mS for one breath
+		for (int LED_ptr=0;LED_ptr<CMD_NUM_LEDS;LED_ptr++)
+		{
+#ifdef FREERUN
+			cmdBuffer->redIntensity[LED_ptr] = 0xFF;				// Green
+			cmdBuffer->grnIntensity[LED_ptr] = 0xFF;				// Red
+			cmdBuffer->bluIntensity[LED_ptr] = 0xFF;				// Blue
+#else
+			cmdBuffer->redIntensity[LED_ptr] = redADC;				// Red
+			cmdBuffer->grnIntensity[LED_ptr] = grnADC;				// Green
+			cmdBuffer->bluIntensity[LED_ptr] = bluADC;				// Blue
+#endif
+		}
+#ifdef FREERUN
+	} else if (demoCounter < 55)
+	{
+		if (demoCounter == 50)
+		{
+			shotCounter = 1;
+		}
+#else
+	} else if (buttonMode == RAINBOW)
+	{
+		shotCounter = 2;
+#endif
+// The knobs pick the hue of the first LED, the saturation and the brightness.  The lanterns
+// turn the wheel themselves, and a lantern that does not know RAINBOW still shows the colors.
+		cmdBuffer->subMode = RAINBOW;
+		cmdBuffer->period_mS = 40;
+		cmdBuffer->modeParam = 0;			// One turn of the wheel along the strip, at the default speed
+		for (int LED_ptr=0;LED_ptr<CMD_NUM_LEDS;LED_ptr++)
+		{
+#ifdef FREERUN
+			hsvToRgb(LED_ptr * (256 / CMD_NUM_LEDS), 0xFF, 0xFF, &rainbowColor);
+#else
+			hsvToRgb(redADC + LED_ptr * (256 / CMD_NUM_LEDS), grnADC, bluADC, &rainbowColor);
+#endif
+			cmdBuffer->redIntensity[LED_ptr] = rainbowColor.red;
+			cmdBuffer->grnIntensity[LED_ptr] = rainbowColor.grn;
+			cmdBuffer->bluIntensity[LED_ptr] = rainbowColor.blu;
+		}
+#ifdef FREERUN
+	} else if (demoCounter < 60)
+	{
+		if (demoCounter == 55)
+		{
+			shotCounter = 1;
+		}
+#else
+	} else if (buttonMode == FIRE)
+	{
+		shotCounter = 2;
+#endif
+// FIRE and PLASMA make their own colors and only take the brightness from the knobs
+		cmdBuffer->subMode = FIRE;
+		cmdBuffer->period_mS = 30;
+		cmdBuffer->modeParam = 0;			// The lanterns' own size and speed of the noise
+		for (int LED_ptr=0;LED_ptr<CMD_NUM_LEDS;LED_ptr++)
+		{
+#ifdef FREERUN
+			cmdBuffer->redIntensity[LED_ptr] = 0xFF;				// Red
+			cmdBuffer->grnIntensity[LED_ptr] = 0xFF;				// Green
+			cmdBuffer->bluIntensity[LED_ptr] = 0xFF;				// Blue
+#else
+			cmdBuffer->redIntensity[LED_ptr] = redADC;				// Red
+			cmdBuffer->grnIntensity[LED_ptr] = grnADC;				// Green
+			cmdBuffer->bluIntensity[LED_ptr] = bluADC;				// Blue
+#endif
+		}
+#ifdef FREERUN
+	} else if (demoCounter < 65)
+	{
+		if (demoCounter == 60)
+		{
+			shotCounter = 1;
+		}
+#else
+	} else if (buttonMode == PLASMA)
+	{
+		shotCounter = 2;
+#endif
+		cmdBuffer->subMode = PLASMA;
+		cmdBuffer->period_mS = 40;
+		cmdBuffer->modeParam = 0;			// The lanterns' own size and speed of the noise
+		for (int LED_ptr=0;LED_ptr<CMD_NUM_LEDS;LED_ptr++)
+		{
+#ifdef FREERUN
+			cmdBuffer->redIntensity[LED_ptr] = 0xFF;				// Red
+			cmdBuffer->grnIntensity[LED_ptr] = 0xFF;				// Green
+			cmdBuffer->bluIntensity[LED_ptr] = 0xFF;				// Blue
+#else
+			cmdBuffer->redIntensity[LED_ptr] = redADC;				// Red
+			cmdBuffer->grnIntensity[LED_ptr] = grnADC;				// Green
+			cmdBuffer->bluIntensity[LED_ptr] = bluADC;				// Blue
+#endif
+		}
+#ifdef FREERUN
+	} else if (demoCounter < 70)
+	{
+		if (demoCounter == 65)
+		{
+			shotCounter = 1;
+		}
+#else
+	} else if (buttonMode == WATER)
+	{
+		shotCounter = 2;
+#endif
+// WATER ripples the knob color
+		cmdBuffer->subMode = WATER;
+		cmdBuffer->period_mS = 40;
+		cmdBuffer->modeParam = 0;			// The lanterns' own size and speed of the noise
+		for (int LED_ptr=0;LED_ptr<CMD_NUM_LEDS;LED_ptr++)
+		{
+#ifdef FREERUN
+			cmdBuffer->redIntensity[LED_ptr] = 0x00;				// Red
+			cmdBuffer->grnIntensity[LED_ptr] = 0x60;				// Green
+			cmdBuffer->bluIntensity[LED_ptr] = 0xFF;				// Blue
+#else
+			cmdBuffer->redIntensity[LED_ptr] = redADC;				// Red
+			cmdBuffer->grnIntensity[LED_ptr] = grnADC;				// Green
+			cmdBuffer->bluIntensity[LED_ptr] = bluADC;				// Blue
+#endif
+		}
+#ifdef FREERUN
+	} else if (demoCounter < 75)
+	{
+		if (demoCounter == 70)
+		{
+			shotCounter = 1;
+		}
+#else
+	} else if (buttonMode == PROGRAM)
+	{
+		shotCounter = 2;
+#endif
+// PROGRAM runs the program in FoolsProgramData.c, so that goes out first, a chunk each time
+// round, and the command after it
+		if (programOffset < programLength)
+		{
+			appSendProgram();
+			return;
+		}
+		cmdBuffer->subMode = PROGRAM;
+		cmdBuffer->period_mS = 40;
+		cmdBuffer->modeParam = 0;			// The program's own speed
+		for (int LED_ptr=0;LED_ptr<CMD_NUM_LEDS;LED_ptr++)
+		{
+#ifdef FREERUN
+			cmdBuffer->redIntensity[LED_ptr] = 0xFF;				// Red
+			cmdBuffer->grnIntensity[LED_ptr] = 0x20;				// Green
+			cmdBuffer->bluIntensity[LED_ptr] = 0x00;				// Blue
+#else
+			cmdBuffer->redIntensity[LED_ptr] = redADC;				// Red
+			cmdBuffer->grnIntensity[LED_ptr] = grnADC;				// Green
+			cmdBuffer->bluIntensity[LED_ptr] = bluADC;				// Blue
+#endif
+		}
 
 	} else
 	{
 		demoCounter = 0;
+		programOffset = 0;
 	}
 	if (shotCounter > 0)
 	{
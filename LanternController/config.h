@@ -68,6 +68,7 @@
 #define APP_SEND_TIMER_INTERVAL		500
 #define IO_POLL_TIMER_INTERVAL		250
 #define COMMAND_TIMEOUT_INTERVAL	25000			// Number of mS between command updates to avoid timeout
+#define CMD_FADE_MS					500				// mS the lanterns take to crossfade into each new command, 0 to cut
 
 #define SYS_SECURITY_MODE                   0
 